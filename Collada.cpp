@@ -0,0 +1,464 @@
+#include "Collada.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+//just enough XML for COLLADA: elements, attributes, and text (comments, processing
+// instructions, and doctypes are skipped; CDATA isn't supported):
+struct Element {
+	std::string name;
+	std::vector< std::pair< std::string, std::string > > attributes;
+	std::string text;
+	std::vector< Element > children;
+
+	//value of attribute 'key' (or "" if it isn't present):
+	std::string attribute(std::string const &key) const {
+		for (auto const &kv : attributes) {
+			if (kv.first == key) return kv.second;
+		}
+		return "";
+	}
+	//first child named 'name' (or nullptr):
+	Element const *child(std::string const &child_name) const {
+		for (auto const &c : children) {
+			if (c.name == child_name) return &c;
+		}
+		return nullptr;
+	}
+};
+
+struct XMLParser {
+	XMLParser(std::string const &text_, std::string const &where_) : text(text_), where(where_) { }
+	std::string const &text;
+	std::string const &where;
+	size_t at = 0;
+
+	void fail(std::string const &what) const {
+		size_t line = 1 + std::count(text.begin(), text.begin() + std::min(at, text.size()), '\n');
+		throw std::runtime_error(where + ":" + std::to_string(line) + ": " + what);
+	}
+
+	bool starts_with(char const *s) const {
+		return text.compare(at, std::strlen(s), s) == 0;
+	}
+	void skip_past(char const *s) {
+		size_t end = text.find(s, at);
+		if (end == std::string::npos) fail(std::string("expected '") + s + "'");
+		at = end + std::strlen(s);
+	}
+	void skip_space() {
+		while (at < text.size() && std::isspace(uint8_t(text[at]))) ++at;
+	}
+	//skip whitespace, comments, <?...?>, and <!...> between elements:
+	void skip_misc() {
+		while (true) {
+			skip_space();
+			if (starts_with("<!--")) skip_past("-->");
+			else if (starts_with("<?")) skip_past("?>");
+			else if (starts_with("<!")) skip_past(">");
+			else break;
+		}
+	}
+
+	static bool is_name_char(char c) {
+		return std::isalnum(uint8_t(c)) || c == '_' || c == ':' || c == '-' || c == '.';
+	}
+	std::string read_name() {
+		size_t begin = at;
+		while (at < text.size() && is_name_char(text[at])) ++at;
+		if (at == begin) fail("expected a name");
+		return text.substr(begin, at - begin);
+	}
+
+	//decode the predefined entities (and numeric ones in the ASCII range):
+	std::string unescape(size_t begin, size_t end) const {
+		std::string ret;
+		ret.reserve(end - begin);
+		for (size_t i = begin; i < end; ++i) {
+			if (text[i] != '&') {
+				ret += text[i];
+				continue;
+			}
+			size_t semi = text.find(';', i);
+			if (semi == std::string::npos || semi > end) {
+				ret += text[i];
+				continue;
+			}
+			std::string entity = text.substr(i + 1, semi - i - 1);
+			if (entity == "lt") ret += '<';
+			else if (entity == "gt") ret += '>';
+			else if (entity == "amp") ret += '&';
+			else if (entity == "quot") ret += '"';
+			else if (entity == "apos") ret += '\'';
+			else if (!entity.empty() && entity[0] == '#') {
+				long code = (entity.size() > 1 && entity[1] == 'x' ? std::strtol(entity.c_str() + 2, nullptr, 16) : std::strtol(entity.c_str() + 1, nullptr, 10));
+				ret += (code > 0 && code < 128 ? char(code) : '?');
+			} else {
+				ret += text.substr(i, semi + 1 - i);
+			}
+			i = semi;
+		}
+		return ret;
+	}
+
+	//parse the element starting at 'at' (which should be its '<'):
+	Element parse_element() {
+		Element element;
+		if (at >= text.size() || text[at] != '<') fail("expected an element");
+		++at;
+		element.name = read_name();
+
+		//attributes:
+		while (true) {
+			skip_space();
+			if (at >= text.size()) fail("unterminated <" + element.name + ">");
+			if (starts_with("/>")) {
+				at += 2;
+				return element;
+			}
+			if (text[at] == '>') {
+				++at;
+				break;
+			}
+			std::string key = read_name();
+			skip_space();
+			if (at >= text.size() || text[at] != '=') fail("expected '=' after attribute '" + key + "'");
+			++at;
+			skip_space();
+			if (at >= text.size() || (text[at] != '"' && text[at] != '\'')) fail("expected a quoted value for attribute '" + key + "'");
+			char quote = text[at];
+			size_t end = text.find(quote, at + 1);
+			if (end == std::string::npos) fail("unterminated value for attribute '" + key + "'");
+			element.attributes.emplace_back(key, unescape(at + 1, end));
+			at = end + 1;
+		}
+
+		//content:
+		while (true) {
+			size_t lt = text.find('<', at);
+			if (lt == std::string::npos) fail("unterminated <" + element.name + ">");
+			if (lt > at) element.text += unescape(at, lt);
+			at = lt;
+			if (starts_with("</")) {
+				at += 2;
+				if (read_name() != element.name) fail("mismatched closing tag for <" + element.name + ">");
+				skip_space();
+				if (at >= text.size() || text[at] != '>') fail("expected '>'");
+				++at;
+				return element;
+			} else if (starts_with("<![CDATA[")) {
+				fail("CDATA sections aren't supported");
+			} else if (starts_with("<!--") || starts_with("<?")) {
+				skip_misc();
+			} else {
+				element.children.emplace_back(parse_element());
+			}
+		}
+	}
+};
+
+//a <source>'s numbers, read through its accessor:
+struct Source {
+	std::vector< float > values;
+	size_t stride = 0; //floats per element
+	size_t offset = 0; //of the first element
+	size_t count = 0; //elements
+
+	float get(size_t element, size_t component) const {
+		return values[offset + element * stride + component];
+	}
+};
+
+//one <input> of a primitive, resolved to the source it reads:
+struct Input {
+	Source const *source = nullptr;
+	size_t offset = 0; //within each vertex's run of <p> indices
+};
+
+}
+
+//parse whitespace-separated numbers:
+template< typename T >
+static void parse_numbers(std::string const &text, std::vector< T > *_to, std::string const &what) {
+	auto &to = *_to;
+	char const *at = text.c_str();
+	while (true) {
+		while (*at && std::isspace(uint8_t(*at))) ++at;
+		if (!*at) break;
+		char *end = nullptr;
+		double value = std::strtod(at, &end);
+		if (end == at) {
+			throw std::runtime_error(what + " contains something that isn't a number.");
+		}
+		to.emplace_back(T(value));
+		at = end;
+	}
+}
+
+Collada::Collada(std::string const &filename) : where(filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	std::ostringstream text;
+	text << file.rdbuf();
+	if (!file) {
+		throw std::runtime_error("Failed to read '" + filename + "'.");
+	}
+	parse(text.str());
+}
+
+Collada::Collada(std::string const &text, std::string const &where_) : where(where_) {
+	parse(text);
+}
+
+Collada::Geometry const &Collada::lookup(std::string const &id) const {
+	if (id.empty()) {
+		if (geometries.size() != 1) {
+			throw std::runtime_error(where + " has " + std::to_string(geometries.size()) + " geometries (expecting exactly one, or an id).");
+		}
+		return geometries[0];
+	}
+	for (auto const &geometry : geometries) {
+		if (geometry.id == id) return geometry;
+	}
+	throw std::runtime_error(where + " has no geometry with id '" + id + "'.");
+}
+
+void Collada::parse(std::string const &text) {
+	XMLParser parser(text, where);
+	parser.skip_misc();
+	Element root = parser.parse_element();
+	if (root.name != "COLLADA") {
+		throw std::runtime_error(where + ": root element is <" + root.name + ">, not <COLLADA>.");
+	}
+
+	//"#id" -> "id":
+	auto local_id = [this](std::string const &url) -> std::string {
+		if (url.empty() || url[0] != '#') {
+			throw std::runtime_error(where + ": reference '" + url + "' isn't to this file.");
+		}
+		return url.substr(1);
+	};
+
+	for (Element const &library : root.children) {
+		if (library.name != "library_geometries") continue;
+		for (Element const &geometry_element : library.children) {
+			if (geometry_element.name != "geometry") continue;
+			Element const *mesh = geometry_element.child("mesh");
+			if (!mesh) continue; //(e.g., splines)
+
+			geometries.emplace_back();
+			Geometry &geometry = geometries.back();
+			geometry.id = geometry_element.attribute("id");
+			geometry.name = geometry_element.attribute("name");
+			std::string what = where + ": geometry '" + geometry.id + "'";
+
+			//sources by id:
+			std::map< std::string, Source > sources;
+			for (Element const &source_element : mesh->children) {
+				if (source_element.name != "source") continue;
+				Source &source = sources[source_element.attribute("id")];
+				Element const *array = source_element.child("float_array");
+				if (!array) {
+					throw std::runtime_error(what + ": source '" + source_element.attribute("id") + "' has no float_array.");
+				}
+				parse_numbers(array->text, &source.values, what + ": float_array");
+				source.stride = 1;
+				source.count = source.values.size();
+				Element const *technique = source_element.child("technique_common");
+				Element const *accessor = (technique ? technique->child("accessor") : nullptr);
+				if (accessor) {
+					std::string stride = accessor->attribute("stride");
+					std::string offset = accessor->attribute("offset");
+					std::string count = accessor->attribute("count");
+					if (!stride.empty()) source.stride = std::strtoul(stride.c_str(), nullptr, 10);
+					if (!offset.empty()) source.offset = std::strtoul(offset.c_str(), nullptr, 10);
+					if (!count.empty()) source.count = std::strtoul(count.c_str(), nullptr, 10);
+				}
+				if (source.stride == 0 || source.offset + source.count * source.stride > source.values.size()) {
+					throw std::runtime_error(what + ": accessor of source '" + source_element.attribute("id") + "' reads past its array.");
+				}
+			}
+			auto find_source = [&](std::string const &url) -> Source const * {
+				auto f = sources.find(local_id(url));
+				if (f == sources.end()) {
+					throw std::runtime_error(what + ": no source '" + url + "'.");
+				}
+				return &f->second;
+			};
+
+			//<vertices> groups per-vertex inputs (POSITION, and sometimes NORMAL or COLOR):
+			Element const *vertices = mesh->child("vertices");
+			if (!vertices) {
+				throw std::runtime_error(what + " has no <vertices>.");
+			}
+			Source const *vertex_position = nullptr;
+			Source const *vertex_normal = nullptr;
+			Source const *vertex_color = nullptr;
+			for (Element const &input : vertices->children) {
+				if (input.name != "input") continue;
+				std::string semantic = input.attribute("semantic");
+				if (semantic == "POSITION") vertex_position = find_source(input.attribute("source"));
+				else if (semantic == "NORMAL") vertex_normal = find_source(input.attribute("source"));
+				else if (semantic == "COLOR") vertex_color = find_source(input.attribute("source"));
+			}
+			if (!vertex_position || vertex_position->stride < 3) {
+				throw std::runtime_error(what + " has no three-component POSITION input.");
+			}
+
+			for (Element const &primitive : mesh->children) {
+				bool triangles = (primitive.name == "triangles");
+				bool polylist = (primitive.name == "polylist");
+				bool polygons = (primitive.name == "polygons");
+				if (!triangles && !polylist && !polygons) {
+					if (primitive.name == "lines" || primitive.name == "linestrips" || primitive.name == "tristrips" || primitive.name == "trifans") {
+						throw std::runtime_error(what + ": <" + primitive.name + "> isn't supported.");
+					}
+					continue;
+				}
+
+				//inputs; each vertex in <p> is a run of 'stride' indices, one per input offset:
+				Input vertex, normal, color;
+				size_t stride = 0;
+				uint32_t color_set = -1U;
+				for (Element const &input : primitive.children) {
+					if (input.name != "input") continue;
+					std::string semantic = input.attribute("semantic");
+					size_t offset = std::strtoul(input.attribute("offset").c_str(), nullptr, 10);
+					stride = std::max(stride, offset + 1);
+					if (semantic == "VERTEX") {
+						if (local_id(input.attribute("source")) != vertices->attribute("id")) {
+							throw std::runtime_error(what + ": VERTEX input doesn't refer to <vertices>.");
+						}
+						vertex.source = vertex_position;
+						vertex.offset = offset;
+					} else if (semantic == "NORMAL") {
+						normal.source = find_source(input.attribute("source"));
+						normal.offset = offset;
+					} else if (semantic == "COLOR") {
+						//(use the lowest-numbered color set, like Blender's active vertex colors on export)
+						uint32_t set = uint32_t(std::strtoul(input.attribute("set").c_str(), nullptr, 10));
+						if (set < color_set) {
+							color_set = set;
+							color.source = find_source(input.attribute("source"));
+							color.offset = offset;
+						}
+					}
+				}
+				if (!vertex.source) {
+					throw std::runtime_error(what + ": <" + primitive.name + "> has no VERTEX input.");
+				}
+				if (normal.source && normal.source->stride < 3) {
+					throw std::runtime_error(what + ": NORMAL input has fewer than three components.");
+				}
+				if (color.source && color.source->stride < 3) {
+					throw std::runtime_error(what + ": COLOR input has fewer than three components.");
+				}
+
+				//corners of one polygon (as index runs into 'p'), appended as a triangle fan:
+				auto add_polygon = [&](std::vector< uint32_t > const &p, size_t first, size_t count) {
+					if (count < 3) return;
+					if ((first + count) * stride > p.size()) {
+						throw std::runtime_error(what + ": <p> is shorter than its primitive says.");
+					}
+					auto corner = [&](size_t v) -> Corner {
+						uint32_t const *indices = &p[(first + v) * stride];
+						uint32_t position_index = indices[vertex.offset];
+						if (position_index >= vertex.source->count) {
+							throw std::runtime_error(what + ": position index out of range.");
+						}
+						Corner c;
+						c.position = glm::vec3(vertex.source->get(position_index, 0), vertex.source->get(position_index, 1), vertex.source->get(position_index, 2));
+
+						Source const *normal_source = (normal.source ? normal.source : vertex_normal);
+						uint32_t normal_index = (normal.source ? indices[normal.offset] : position_index);
+						if (normal_source) {
+							if (normal_index >= normal_source->count) {
+								throw std::runtime_error(what + ": normal index out of range.");
+							}
+							c.normal = glm::vec3(normal_source->get(normal_index, 0), normal_source->get(normal_index, 1), normal_source->get(normal_index, 2));
+						} else {
+							c.normal = glm::vec3(0.0f); //(filled in per face, below)
+						}
+
+						Source const *color_source = (color.source ? color.source : vertex_color);
+						uint32_t color_index = (color.source ? indices[color.offset] : position_index);
+						c.color = glm::u8vec4(0xff);
+						if (color_source) {
+							if (color_index >= color_source->count) {
+								throw std::runtime_error(what + ": color index out of range.");
+							}
+							//(truncated like export-meshes.py; alpha is always opaque)
+							for (uint32_t i = 0; i < 3; ++i) {
+								float value = color_source->get(color_index, i);
+								c.color[i] = uint8_t(std::max(0.0f, std::min(255.0f, value * 255.0f)));
+							}
+						}
+						return c;
+					};
+
+					Corner const anchor = corner(0);
+					Corner previous = corner(1);
+					for (size_t v = 2; v < count; ++v) {
+						Corner next = corner(v);
+						geometry.corners.emplace_back(anchor);
+						geometry.corners.emplace_back(previous);
+						geometry.corners.emplace_back(next);
+						if (!normal.source && !vertex_normal) {
+							Corner *tri = &geometry.corners[geometry.corners.size() - 3];
+							glm::vec3 n = glm::cross(tri[1].position - tri[0].position, tri[2].position - tri[0].position);
+							float length = glm::length(n);
+							n = (length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f));
+							tri[0].normal = tri[1].normal = tri[2].normal = n;
+						}
+						previous = next;
+					}
+				};
+
+				if (triangles) {
+					Element const *p_element = primitive.child("p");
+					if (!p_element) continue; //(no triangles)
+					std::vector< uint32_t > p;
+					parse_numbers(p_element->text, &p, what + ": <p>");
+					std::string count_attribute = primitive.attribute("count");
+					size_t count = (count_attribute.empty() ? p.size() / (3 * stride) : std::strtoul(count_attribute.c_str(), nullptr, 10));
+					for (size_t t = 0; t < count; ++t) {
+						add_polygon(p, 3 * t, 3);
+					}
+				} else if (polylist) {
+					Element const *vcount_element = primitive.child("vcount");
+					Element const *p_element = primitive.child("p");
+					if (!vcount_element || !p_element) continue;
+					std::vector< uint32_t > vcount, p;
+					parse_numbers(vcount_element->text, &vcount, what + ": <vcount>");
+					parse_numbers(p_element->text, &p, what + ": <p>");
+					size_t first = 0;
+					for (uint32_t count : vcount) {
+						add_polygon(p, first, count);
+						first += count;
+					}
+				} else { //polygons: one <p> per polygon
+					for (Element const &p_element : primitive.children) {
+						if (p_element.name == "ph") {
+							throw std::runtime_error(what + ": polygons with holes (<ph>) aren't supported.");
+						}
+						if (p_element.name != "p") continue;
+						std::vector< uint32_t > p;
+						parse_numbers(p_element.text, &p, what + ": <p>");
+						add_polygon(p, 0, p.size() / stride);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+//Collada reads the triangle meshes out of a COLLADA (.dae) file, like the ones Blender exports:
+//
+//   Collada dae("meshes/goose.dae");
+//   for (auto const &geometry : dae.geometries) { ... geometry.corners ... }
+//
+//Only <library_geometries> is read -- scene nodes (and so object transforms) are ignored,
+// which matches how export-meshes.py writes each mesh in its own coordinates.
+//Polygons (<polylist>, <polygons>) are split into triangle fans; normals missing from
+// the file are computed per face and missing colors are white.
+//Doesn't use OpenGL, so tools (see meshc.cpp) can link it.
+
+struct Collada {
+	//loads 'filename'; throws (naming the file) if it can't be read or parsed:
+	Collada(std::string const &filename);
+
+	//or parse already-loaded text; 'where' names it in error messages:
+	Collada(std::string const &text, std::string const &where);
+
+	struct Corner {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::u8vec4 color;
+	};
+
+	struct Geometry {
+		std::string id; //<geometry id="...">
+		std::string name; //<geometry name="..."> (Blender's mesh name)
+		std::vector< Corner > corners; //three per triangle, counter-clockwise
+	};
+	std::vector< Geometry > geometries;
+
+	//throws if there isn't exactly one geometry (when 'id' is empty) or one with that id:
+	Geometry const &lookup(std::string const &id = "") const;
+
+	std::string where; //filename (for error messages)
+
+	void parse(std::string const &text);
+};
@@ -1,49 +1,99 @@
 #include "Game.hpp"
 
 #include "gl_errors.hpp" //helper for dumpping OpenGL error messages
-#include "read_chunk.hpp" //helper for reading a vector of structures from a file
+#include "MeshLoader.hpp" //reads meshes.blob on a background thread
 #include "data_path.hpp" //helper to get paths relative to executable
+#include "Profiler.hpp" //PROFILE_SCOPE
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <iostream>
-#include <fstream>
-#include <map>
+#include <chrono>
+#include <thread>
 #include <cstddef>
-#include <random>
+#include <cstring>
 
 using std::cout;
 using std::endl;
 //helper defined later; throws if shader compilation fails:
 static GLuint compile_shader(GLenum type, std::string const &source);
+//helper defined later; throws if program linking fails:
+static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader);
+
+//meshes the game draws, loaded (in this order) while the game starts; see Game::poll_meshes:
+static std::vector< std::string > const startup_meshes = {
+	"BG", "Doll", "Cube", "Egg", "White", "Red", "GameOver", "Restart",
+	"0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+};
+
+Game::Game(uint64_t seed) : state(seed) {
+	PROFILE_SCOPE("Game::Game");
+	recording.header.seed = seed;
+
+	//Meshes are read on a background thread (see MeshLoader) while shaders compile here and main.cpp
+	// shows the window; poll_meshes() uploads them as they become ready.
+	//The blob is mapped first, since its vertex format decides how the vertex shader decodes attributes:
+	mesh_loader.reset(new MeshLoader(data_path("meshes.blob"), startup_meshes));
+	//quantized blobs store compact 12-byte vertices (see MeshIndex::PackedVertex):
+	bool quantized = mesh_loader->quantized;
 
-Game::Game() {
 	{ //create an opengl program to perform sun/sky (well, directional+hemispherical) lighting:
-		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
-				"#version 330\n"
-				"uniform mat4 object_to_clip;\n"
-				"uniform mat4x3 object_to_light;\n"
-				"uniform mat3 normal_to_light;\n"
+		PROFILE_SCOPE("compile shaders");
+		//camera and lights live in a std140 block (see FrameUniforms in Game.hpp);
+		//per-copy transforms are fetched from a buffer texture (see RenderQueue.hpp),
+		// so one call can draw many copies of a mesh:
+		std::string uniform_blocks =
+				"layout(std140) uniform Frame {\n" //changes rarely (resize, lighting change)
+				"	mat4 world_to_clip;\n"
+				"	vec3 sun_direction;\n"
+				"	vec3 sun_color;\n"
+				"	vec3 sky_direction;\n"
+				"	vec3 sky_color;\n"
+				"};\n"
+				;
+		std::string vertex_source =
+				"uniform samplerBuffer transforms;\n" //six texels per copy: object_to_world rows, then normal_to_world rows
+				"uniform int first_transform;\n" //transform used by the first copy in this draw
 				"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
+				"#ifdef QUANTIZED\n"
+				"in vec2 Normal;\n" //octahedral-encoded, in [-127,127]
+				"#else\n"
 				"in vec3 Normal;\n"
+				"#endif\n"
 				"in vec4 Color;\n"
 				"out vec3 position;\n"
 				"out vec3 normal;\n"
 				"out vec4 color;\n"
 				"void main() {\n"
-				"	gl_Position = object_to_clip * Position;\n"
-				"	position = object_to_light * Position;\n"
-				"	normal = normal_to_light * Normal;\n"
+				"	int t = 6 * (first_transform + gl_InstanceID);\n"
+				"	mat4x3 object_to_world = transpose(mat3x4(texelFetch(transforms, t), texelFetch(transforms, t+1), texelFetch(transforms, t+2)));\n"
+				"	mat3 normal_to_world = transpose(mat3(texelFetch(transforms, t+3).xyz, texelFetch(transforms, t+4).xyz, texelFetch(transforms, t+5).xyz));\n"
+				"#ifdef QUANTIZED\n"
+				"	vec4 object_position = vec4(Position.xyz, 1.0);\n" //(dequantization is part of object_to_world)
+				"	vec2 e = Normal / 127.0;\n"
+				"	vec3 object_normal = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+				"	if (object_normal.z < 0.0) {\n"
+				"		object_normal.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);\n"
+				"	}\n"
+				"#else\n"
+				"	vec4 object_position = Position;\n"
+				"	vec3 object_normal = Normal;\n"
+				"#endif\n"
+				"	position = object_to_world * object_position;\n"
+				"	gl_Position = world_to_clip * vec4(position, 1.0);\n"
+				"	normal = normal_to_world * object_normal;\n"
 				"	color = Color;\n"
 				"}\n"
+				;
+
+		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
+				std::string("#version 330\n") + (quantized ? "#define QUANTIZED\n" : "") + uniform_blocks + vertex_source
 				);
 
 		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
 				"#version 330\n"
-				"uniform vec3 sun_direction;\n"
-				"uniform vec3 sun_color;\n"
-				"uniform vec3 sky_direction;\n"
-				"uniform vec3 sky_color;\n"
+				+ uniform_blocks +
 				"in vec3 position;\n"
 				"in vec3 normal;\n"
 				"in vec4 color;\n"
@@ -65,203 +115,226 @@ Game::Game() {
 				"}\n"
 				);
 
-		simple_shading.program = glCreateProgram();
-		glAttachShader(simple_shading.program, vertex_shader);
-		glAttachShader(simple_shading.program, fragment_shader);
+		simple_shading.program = link_program(vertex_shader, fragment_shader);
+
 		//shaders are reference counted so this makes sure they are freed after program is deleted:
 		glDeleteShader(vertex_shader);
 		glDeleteShader(fragment_shader);
-
-		//link the shader program and throw errors if linking fails:
-		glLinkProgram(simple_shading.program);
-		GLint link_status = GL_FALSE;
-		glGetProgramiv(simple_shading.program, GL_LINK_STATUS, &link_status);
-		if (link_status != GL_TRUE) {
-			std::cerr << "Failed to link shader program." << std::endl;
-			GLint info_log_length = 0;
-			glGetProgramiv(simple_shading.program, GL_INFO_LOG_LENGTH, &info_log_length);
-			std::vector< GLchar > info_log(info_log_length, 0);
-			GLsizei length = 0;
-			glGetProgramInfoLog(simple_shading.program, GLsizei(info_log.size()), &length, &info_log[0]);
-			std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-			throw std::runtime_error("failed to link program");
-		}
 	}
 
 	{ //read back uniform and attribute locations from the shader program:
-		simple_shading.object_to_clip_mat4 = glGetUniformLocation(simple_shading.program, "object_to_clip");
-		simple_shading.object_to_light_mat4x3 = glGetUniformLocation(simple_shading.program, "object_to_light");
-		simple_shading.normal_to_light_mat3 = glGetUniformLocation(simple_shading.program, "normal_to_light");
-
-		simple_shading.sun_direction_vec3 = glGetUniformLocation(simple_shading.program, "sun_direction");
-		simple_shading.sun_color_vec3 = glGetUniformLocation(simple_shading.program, "sun_color");
-		simple_shading.sky_direction_vec3 = glGetUniformLocation(simple_shading.program, "sky_direction");
-		simple_shading.sky_color_vec3 = glGetUniformLocation(simple_shading.program, "sky_color");
+		simple_shading.transforms_samplerBuffer = glGetUniformLocation(simple_shading.program, "transforms");
+		simple_shading.first_transform_int = glGetUniformLocation(simple_shading.program, "first_transform");
 
 		simple_shading.Position_vec4 = glGetAttribLocation(simple_shading.program, "Position");
 		simple_shading.Normal_vec3 = glGetAttribLocation(simple_shading.program, "Normal");
 		simple_shading.Color_vec4 = glGetAttribLocation(simple_shading.program, "Color");
 	}
 
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-	};
-	static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
-
-	{ //load mesh data from a binary blob:
-		std::ifstream blob(data_path("meshes.blob"), std::ios::binary);
-		//The blob will be made up of three chunks:
-		// the first chunk will be vertex data (interleaved position/normal/color)
-		// the second chunk will be characters
-		// the third chunk will be an index, mapping a name (range of characters) to a mesh (range of vertex data)
-
-		//read vertex data:
-		std::vector< Vertex > vertices;
-		read_chunk(blob, "dat0", &vertices);
-
-		//read character data (for names):
-		std::vector< char > names;
-		read_chunk(blob, "str0", &names);
-
-		//read index:
-		struct IndexEntry {
-			uint32_t name_begin;
-			uint32_t name_end;
-			uint32_t vertex_begin;
-			uint32_t vertex_end;
-		};
-		static_assert(sizeof(IndexEntry) == 16, "IndexEntry should be packed.");
+	{ //connect the program's uniform block to its binding point, and create a buffer to back it:
+		GLuint frame_index = glGetUniformBlockIndex(simple_shading.program, "Frame");
+		if (frame_index != GL_INVALID_INDEX) glUniformBlockBinding(simple_shading.program, frame_index, FrameUniformsBinding);
 
-		std::vector< IndexEntry > index_entries;
-		read_chunk(blob, "idx0", &index_entries);
+		glGenBuffers(1, &frame_ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-		if (blob.peek() != EOF) {
-			std::cerr << "WARNING: trailing data in meshes file." << std::endl;
-		}
+		glBindBufferBase(GL_UNIFORM_BUFFER, FrameUniformsBinding, frame_ubo);
+	}
 
-		//upload vertex data to the graphics card:
+	{ //transforms are read from the texture unit the render queue binds them to:
+		glUseProgram(simple_shading.program);
+		glUniform1i(simple_shading.transforms_samplerBuffer, RenderQueue::TransformsUnit);
+		glUseProgram(0);
+	}
+
+	//vertex records are MeshIndex::Vertex (28-byte floats) or MeshIndex::PackedVertex (12-byte quantized):
+	typedef MeshIndex::Vertex Vertex;
+	typedef MeshIndex::PackedVertex PackedVertex;
+
+	{ //make room for all vertex and index data on the graphics card (filled in as meshes load; see upload_mesh()):
 		glGenBuffers(1, &meshes_vbo);
 		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, mesh_loader->vertices.bytes(), nullptr, GL_STATIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		//create map to store index entries:
-		std::map< std::string, Mesh > index;
-		for (IndexEntry const &e : index_entries) {
-			if (e.name_begin > e.name_end || e.name_end > names.size()) {
-				throw std::runtime_error("invalid name indices in index.");
-			}
-			if (e.vertex_begin > e.vertex_end || e.vertex_end > vertices.size()) {
-				throw std::runtime_error("invalid vertex indices in index.");
-			}
-			Mesh mesh;
-			mesh.first = e.vertex_begin;
-			mesh.count = e.vertex_end - e.vertex_begin;
-			auto ret = index.insert(std::make_pair(
-						std::string(names.begin() + e.name_begin, names.begin() + e.name_end),
-						mesh));
-			if (!ret.second) {
-				throw std::runtime_error("duplicate name in index.");
-			}
+		if (mesh_loader->indexed) {
+			//(uploaded through the ARRAY_BUFFER target since ELEMENT_ARRAY_BUFFER binding is part of VAO state)
+			glGenBuffers(1, &meshes_ibo);
+			glBindBuffer(GL_ARRAY_BUFFER, meshes_ibo);
+			glBufferData(GL_ARRAY_BUFFER, mesh_loader->indices.bytes(), nullptr, GL_STATIC_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		}
-
-		//look up into index map to extract meshes:
-		auto lookup = [&index](std::string const &name) -> Mesh {
-			auto f = index.find(name);
-			if (f == index.end()) {
-				throw std::runtime_error("Mesh named '" + name + "' does not appear in index.");
-			}
-			return f->second;
-		};
-		cursor_mesh = lookup("White");
-		cursor_mesh_red = lookup("Red");
-		duck_mesh = lookup("Doll");
-		target_mesh = lookup("Egg");
-		enemy_mesh = lookup("Cube");
-		bg_mesh = lookup("BG");
-		game_over_mesh = lookup("GameOver");
-		restart_mesh = lookup("Restart");
-
-		//number meshes are from 
-		//https://www.turbosquid.com/3d-models/free-numbers-1-2-3d-model/266953
-		Mesh mesh0 = lookup("0");
-		numbers.emplace_back(mesh0);	
-		Mesh mesh1 = lookup("1");
-		numbers.emplace_back(mesh1);	
-		Mesh mesh2 = lookup("2");
-		numbers.emplace_back(mesh2);	
-		Mesh mesh3 = lookup("3");
-		numbers.emplace_back(mesh3);	
-		Mesh mesh4 = lookup("4");
-		numbers.emplace_back(mesh4);	
-		Mesh mesh5 = lookup("5");
-		numbers.emplace_back(mesh5);	
-		Mesh mesh6 = lookup("6");
-		numbers.emplace_back(mesh6);	
-		Mesh mesh7 = lookup("7");
-		numbers.emplace_back(mesh7);	
-		Mesh mesh8 = lookup("8");
-		numbers.emplace_back(mesh8);	
-		Mesh mesh9 = lookup("9");
-		numbers.emplace_back(mesh9);	
-
 	}
 
 	{ //create vertex array object to hold the map from the mesh vertex buffer to shader program attributes:
 		glGenVertexArrays(1, &meshes_for_simple_shading_vao);
 		glBindVertexArray(meshes_for_simple_shading_vao);
 		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
-		//note that I'm specifying a 3-vector for a 4-vector attribute here, and this is okay to do:
-		glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Position));
-		glEnableVertexAttribArray(simple_shading.Position_vec4);
-		if (simple_shading.Normal_vec3 != -1U) {
-			glVertexAttribPointer(simple_shading.Normal_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Normal));
-			glEnableVertexAttribArray(simple_shading.Normal_vec3);
-		}
-		if (simple_shading.Color_vec4 != -1U) {
-			glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Color));
-			glEnableVertexAttribArray(simple_shading.Color_vec4);
+		if (quantized) {
+			//integer attributes are converted to float as-is (not normalized); the shader does the scaling:
+			glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (GLbyte *)0 + offsetof(PackedVertex, Position));
+			glEnableVertexAttribArray(simple_shading.Position_vec4);
+			if (simple_shading.Normal_vec3 != -1U) {
+				glVertexAttribPointer(simple_shading.Normal_vec3, 2, GL_BYTE, GL_FALSE, sizeof(PackedVertex), (GLbyte *)0 + offsetof(PackedVertex, Normal));
+				glEnableVertexAttribArray(simple_shading.Normal_vec3);
+			}
+			if (simple_shading.Color_vec4 != -1U) {
+				glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (GLbyte *)0 + offsetof(PackedVertex, Color));
+				glEnableVertexAttribArray(simple_shading.Color_vec4);
+			}
+		} else {
+			//note that I'm specifying a 3-vector for a 4-vector attribute here, and this is okay to do:
+			glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Position));
+			glEnableVertexAttribArray(simple_shading.Position_vec4);
+			if (simple_shading.Normal_vec3 != -1U) {
+				glVertexAttribPointer(simple_shading.Normal_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Normal));
+				glEnableVertexAttribArray(simple_shading.Normal_vec3);
+			}
+			if (simple_shading.Color_vec4 != -1U) {
+				glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Color));
+				glEnableVertexAttribArray(simple_shading.Color_vec4);
+			}
 		}
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (meshes_ibo != -1U) {
+			//the element buffer binding is remembered by the vertex array object:
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshes_ibo);
+		}
+		glBindVertexArray(0);
 	}
 
+	simple_shading_pipeline.program = simple_shading.program;
+	simple_shading_pipeline.vao = meshes_for_simple_shading_vao;
+	simple_shading_pipeline.first_transform_int = simple_shading.first_transform_int;
+
+	//time each pass on the GPU (if gpu_timers is enabled):
+	render_queue.on_pass = [this](RenderQueue::Pass pass) {
+		static GpuTimers::Section const sections[RenderQueue::PassCount] = {
+			GpuTimers::Background, //BackgroundPass
+			GpuTimers::Objects, //ObjectsPass
+			GpuTimers::HUD, //HUDPass
+		};
+		gpu_timers.mark(sections[pass]);
+	};
+
 	GL_ERRORS();
+}
 
-	//----------------
-	//set up game board with meshes and rolls:
-	board_translations.reserve(board_size.x * board_size.y); 
-	duck_pos = glm::mat4(
-			0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f);
-	cursor_rotation = glm::quat();
-	;
-
-	std::vector< Mesh const * > meshes{ &duck_mesh, &target_mesh, &enemy_mesh };
-
-	board_translations.emplace_back(glm::mat4(
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 3.0f, 0.0f, 0.0f));
-	bump.emplace_back(0.0f);
-
-	std::mt19937 mt(0xbead1234); //wtf apparently random num gen
-	for(uint32_t i = 0; i<7; i++){
-		add_target();
+bool Game::poll_meshes() {
+	if (meshes_ready) return true;
+	PROFILE_SCOPE("Game::poll_meshes");
+
+	//upload whatever the loader has finished since last time:
+	uint32_t ready = mesh_loader->ready();
+	for (; meshes_uploaded < ready; ++meshes_uploaded) {
+		upload_mesh(mesh_loader->names[meshes_uploaded], mesh_loader->meshes[meshes_uploaded]);
+	}
+	if (ready < startup_meshes.size()) return false;
+
+	//look up into index map to extract meshes (all loaded by now):
+	auto lookup = [this](std::string const &name) -> Mesh {
+		return load_mesh(name);
+	};
+	cursor_mesh = lookup("White");
+	cursor_mesh_red = lookup("Red");
+	duck_mesh = lookup("Doll");
+	target_mesh = lookup("Egg");
+	enemy_mesh = lookup("Cube");
+	bg_mesh = lookup("BG");
+	game_over_mesh = lookup("GameOver");
+	restart_mesh = lookup("Restart");
+
+	//number meshes are from 
+	//https://www.turbosquid.com/3d-models/free-numbers-1-2-3d-model/266953
+	Mesh mesh0 = lookup("0");
+	numbers.emplace_back(mesh0);	
+	Mesh mesh1 = lookup("1");
+	numbers.emplace_back(mesh1);	
+	Mesh mesh2 = lookup("2");
+	numbers.emplace_back(mesh2);	
+	Mesh mesh3 = lookup("3");
+	numbers.emplace_back(mesh3);	
+	Mesh mesh4 = lookup("4");
+	numbers.emplace_back(mesh4);	
+	Mesh mesh5 = lookup("5");
+	numbers.emplace_back(mesh5);	
+	Mesh mesh6 = lookup("6");
+	numbers.emplace_back(mesh6);	
+	Mesh mesh7 = lookup("7");
+	numbers.emplace_back(mesh7);	
+	Mesh mesh8 = lookup("8");
+	numbers.emplace_back(mesh8);	
+	Mesh mesh9 = lookup("9");
+	numbers.emplace_back(mesh9);	
+
+	meshes_ready = true;
+	return true;
+}
+
+void Game::wait_for_meshes() {
+	PROFILE_SCOPE("Game::wait_for_meshes");
+	while (!poll_meshes()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+Mesh const &Game::load_mesh(std::string const &name) {
+	if (!mesh_loader->done()) {
+		throw std::runtime_error("Meshes can't be looked up until loading is done (see poll_meshes).");
+	}
+	if (loaded_meshes.count(name)) return mesh_loader->index.lookup(name);
+	Mesh const &mesh = mesh_loader->prepare(name);
+	upload_mesh(name, mesh);
+	return mesh;
+}
+
+void Game::upload_mesh(std::string const &name, Mesh const &mesh) {
+	MeshLoader const &loader = *mesh_loader;
+
+	//vertices go to the same place in meshes_vbo as in the blob:
+	size_t vertex_offset = size_t(mesh.first) * loader.vertex_size;
+	size_t vertex_bytes = size_t(mesh.count) * loader.vertex_size;
+	glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, vertex_offset, vertex_bytes, loader.vertices.begin + vertex_offset);
+	loaded_mesh_bytes += vertex_bytes;
+
+	//...as do indices, of the full mesh and each level of detail:
+	if (meshes_ibo != -1U) {
+		glBindBuffer(GL_ARRAY_BUFFER, meshes_ibo);
+		auto upload = [&](GLuint first, GLsizei count) {
+			size_t offset = size_t(first) * sizeof(uint16_t);
+			size_t bytes = size_t(count) * sizeof(uint16_t);
+			glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, loader.indices.begin + offset);
+			loaded_mesh_bytes += bytes;
+		};
+		upload(mesh.index_first, mesh.index_count);
+		for (uint32_t l = 0; l < mesh.lod_count; ++l) {
+			upload(mesh.lods[l].index_first, mesh.lods[l].index_count);
+		}
 	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	loaded_meshes.insert(name);
+	GL_ERRORS();
 }
 
 Game::~Game() {
 	glDeleteVertexArrays(1, &meshes_for_simple_shading_vao);
 	meshes_for_simple_shading_vao = -1U;
 
+	glDeleteBuffers(1, &frame_ubo);
+	frame_ubo = -1U;
+
 	glDeleteBuffers(1, &meshes_vbo);
 	meshes_vbo = -1U;
 
+	if (meshes_ibo != -1U) {
+		glDeleteBuffers(1, &meshes_ibo);
+		meshes_ibo = -1U;
+	}
+
 	glDeleteProgram(simple_shading.program);
 	simple_shading.program = -1U;
 
@@ -274,229 +347,109 @@ bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
 		return false;
 	}
 
-	//move duck jump angle and power
+	if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_F1) {
+		perf_hud.visible = !perf_hud.visible;
+		return true;
+	}
+
+	//map keys to game actions:
 	if (evt.type == SDL_KEYDOWN|| evt.type == SDL_KEYUP) {
+		bool pressed = (evt.type == SDL_KEYDOWN);
 		if (evt.key.keysym.scancode == SDL_SCANCODE_LEFT) {
-			controls.left = (evt.type == SDL_KEYDOWN);
+			act(GameState::ActionLeft, pressed);
 			return true;
 		} else if (evt.key.keysym.scancode == SDL_SCANCODE_RIGHT) {
-			controls.right = (evt.type == SDL_KEYDOWN);
+			act(GameState::ActionRight, pressed);
 			return true;
 		}
 		if (evt.key.keysym.scancode == SDL_SCANCODE_SPACE) {
-			controls.up = (evt.type == SDL_KEYDOWN);
-			if(controls.up == false && height == 0.0f) {
-				controls.jump = true;
-				velocity = glm::vec2(cursor/20.0f, 2.0*power);
-			}
+			act(GameState::ActionJump, pressed);
 			return true;
 		}
-		if(gameOver && evt.key.keysym.scancode == SDL_SCANCODE_R){
-			restart = true;
+		if (evt.key.keysym.scancode == SDL_SCANCODE_R) {
+			act(GameState::ActionRestart, pressed);
 		}
 	}
 	return false;
 }
 
-void Game::add_target(){
-	//following chunk is from the cppreference on random device
-	//which I looked up after a recommendation from Thejaswi Kadur
-	//https://en.cppreference.com/w/cpp/numeric/random/random_device
-	std::random_device rd;
-	std::uniform_int_distribution<int> dist(0, 0xbead1234);
-	std::mt19937 mt(dist(rd));
-
-	float newX = mt()%100/20.0f;
-	float newY = mt()%100/28.0f;
-	while(newY<1.0f) newY = mt()%100/26.0f;
-	targets.emplace_back(glm::mat4(
-				1.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 1.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 1.0f, 0.0f,
-				newX, newY, 0.0f, 1.0f));
+void Game::act(GameState::Action action, bool pressed) {
+	if (playback) return; //(inputs come from the replay)
+	recording.record(ticks, action, pressed);
+	state.handle_action(action, pressed);
 }
 
-void Game::check_targets(){
-	for(uint32_t i = 0; i < 7; i++){
-		glm::vec2 t_pos = glm::vec2(targets[i][3][0], 
-				targets[i][3][1]);
-		glm::vec2 c_pos = glm::vec2(duck_pos[3][0],
-				height);
-
-		float distance = std::sqrt(std::pow((c_pos[0]-t_pos[0]), 2.0f)
-				+std::pow((c_pos[1]-t_pos[1]), 2.0f));
-		if(distance <= min_r){
-			targets.erase(targets.begin()+i);
-			add_target();
-			score++;
-			//new enemy spawned for each 10 points gained
-
-			if(score%10==0){
-				board_translations.emplace_back(glm::mat4(
-							0.0f, 0.0f, 0.0f, 0.0f,
-							0.0f, 0.0f, 0.0f, 0.0f,
-							0.0f, 0.0f, 0.0f, 0.0f,
-							0.0f, 3.0f, 0.0f, 0.0f));
-				bump.emplace_back(0.0f);
-			}
-
-		}
-	}
+void Game::play(Replay const *replay) {
+	playback = replay;
+	playback_next = 0;
+	if (playback) tick_rate = playback->header.tick_rate;
 }
 
-void Game::check_enemies(){
-	for(uint32_t i = 0; i < board_translations.size(); i++){
-		glm::vec2 t_pos = glm::vec2(board_translations[i][3][0]+0.4f, 
-				board_translations[i][3][1]);
-		glm::vec2 c_pos = glm::vec2(duck_pos[3][0],
-				height);
-		float distance = std::sqrt(std::pow((c_pos[0]-t_pos[0]), 2.0f)
-				+std::pow((c_pos[1]-t_pos[1]), 2.0f));
-		if(distance <= min_r){
-			gameOver = true;
-		}
-	}
-}
-
-void Game::enemies_collision(uint32_t current){
-	glm::vec2 c_pos = glm::vec2(board_translations[current][3][0], 
-			board_translations[current][3][1]);
-	for(uint32_t i = 0; i < board_translations.size(); i++){
-		if(i!=current){
-			glm::vec2 t_pos = glm::vec2(board_translations[i][3][0], 						board_translations[i][3][1]);
-			float distance = std::sqrt(
-					std::pow((c_pos[0]-t_pos[0]), 2.0f)
-					+std::pow((c_pos[1]-t_pos[1]), 2.0f));
-			if(distance <= min_r){
-				bump[current] += 2.0f;
-			}
-		}
-	}
+void Game::save_recording(std::string const &filename) {
+	recording.header.tick_rate = tick_rate;
+	recording.header.ticks = ticks;
+	recording.save(filename);
 }
 
 void Game::update(float elapsed) {
-	//if the roll keys are pressed, rotate everything on the same row or column as the cursor:
-	glm::quat dr = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-	float amt = elapsed * 1.0f;
-	int32_t angle = 1;
-	if (controls.left && cursor>-90) {
-		cursor-=angle;
-		dr = glm::angleAxis(amt, glm::vec3(0.0f, 0.0f, 1.0f)) * dr;
-	}else if (controls.right && cursor<90) {
-		cursor+=angle;
-		dr = glm::angleAxis(-amt, glm::vec3(0.0f, 0.0f, 1.0f)) * dr;
-	}else if (controls.up){
-		if(increase && power<max_power)
-			power+=0.1f;
-		else if(!increase && power>0.0f)
-			power-=0.1f;
-
-		if(increase && power>=max_power) increase = false;
-		if(!increase && power<=0) increase = true;
-	}
-
-	if (dr != glm::quat()) {
-		glm::quat &r = cursor_rotation;
-		r = glm::normalize(dr * r);
-	}
-
-	if(controls.jump){
-		//referenced the discussion here
-		//https://gamedev.stackexchange.com/questions/15708/how-can-i-implement-gravity
-		//although i guess i did take ap physics c...
-		height += elapsed*(velocity.y+elapsed*-4.9f);
-		xpos += elapsed*velocity.x;
-		velocity.y += elapsed*-4.9;
-
-		if(xpos < -0.5f || xpos > 5.5f){
-			velocity.x *= -0.8f;
-		}
-
-		if(height > 3.6){
-			velocity.y = -2.0f;
-		}
-
-		if(height<0.03f){
-			height = 0.0f;
-			power = 0;
-			velocity.x = 0.0f;
-			controls.jump = false;
+	PROFILE_SCOPE("Game::update");
+	//nothing happens until everything that is drawn has loaded (main.cpp shows cleared frames meanwhile):
+	if (!poll_meshes()) return;
+
+	float tick = 1.0f / tick_rate;
+	tick_accumulator = std::min(tick_accumulator + elapsed, max_lag);
+	uint32_t steps = uint32_t(tick_accumulator * tick_rate);
+
+	perf_hud.frame_ms[perf_hud.next] = elapsed * 1000.0f;
+	perf_hud.next = (perf_hud.next + 1) % perf_hud.Frames;
+	//(only the simulation steps themselves are timed, not the snapshot or input playback)
+	float steps_ms = 0.0f;
+
+	for (uint32_t step = 0; step < steps; ++step) {
+		if (step + 1 == steps) {
+			PROFILE_SCOPE("snapshot");
+			//remember what the state looked like before the last step, to interpolate from:
+			previous.duck = glm::vec2(state.duck_pos[3][0], state.height);
+			previous.cursor = state.cursor;
+			previous.power = state.power;
+			previous.geese_x.assign(state.geese.x.begin(), state.geese.x.end());
+			previous.geese_y.assign(state.geese.y.begin(), state.geese.y.end());
+			previous.resets = state.resets;
 		}
-		duck_pos = glm::mat4(
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 0.0f, 0.0f,
-				xpos, height, 0.0f, 0.0f);
-		check_targets();
+		if (playback) playback->apply(ticks, &playback_next, &state);
+		auto step_before = std::chrono::high_resolution_clock::now();
+		state.update(tick);
+		auto step_after = std::chrono::high_resolution_clock::now();
+		steps_ms += std::chrono::duration< float, std::milli >(step_after - step_before).count();
+		ticks += 1;
 	}
 
-	for(uint32_t i = 0; i < board_translations.size(); i++){
-		glm::vec2 target = glm::vec2(duck_pos[3][0], duck_pos[3][1]);
-		glm::vec2 current = glm::vec2(board_translations[i][3][0],
-				board_translations[i][3][1]);
-		float dx = (target[0]-current[0])/(400.0f/speed);
-		float dy = (height-current[1])/(400.0f/speed);
-
-		if(bump[i]>0.0f){
-			dx *= -1.0f;
-			dy *= -1.0f;
-			bump[i] -= elapsed;
-		}
-
-		board_translations[i][3][0] += dx;
-		board_translations[i][3][1] += dy;
+	tick_accumulator = std::max(0.0f, tick_accumulator - steps * tick);
 
-		enemies_collision(i);
-	}
-	check_enemies();
-
-	if(restart){
-		cursor_rotation = glm::quat();
-		board_translations.clear();
-		bump.clear();
-		board_translations.emplace_back(glm::mat4(
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 3.0f, 0.0f, 0.0f));
-		bump.emplace_back(0.0f);
-		
-		targets.clear();
-		for(uint32_t i = 0; i<7; i++){
-			add_target();
-		}
-	
-		gameOver = false;
-		restart = false;
-		cursor = 0; //should only be between -90 and 90
-		score = 0;
-		
-		duck_pos = glm::mat4(
-			0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f);
-		height = 0.0f; //ducks height
-		xpos = 0.0f; //ducks horizontal position 
-		velocity = glm::vec2(0.0f, 0.0f);
+	if (steps > 0) {
+		perf_hud.tick_ms = steps_ms / float(steps);
 	}
-
 }
 
 void Game::draw(glm::uvec2 drawable_size) {
+	PROFILE_SCOPE("Game::draw");
+	if (!meshes_ready) return;
+
 	//Set up a transformation matrix to fit the board in the window:
-	glm::mat4 world_to_clip;
-	{
+	// (only recomputed when the drawable size changes)
+	if (drawable_size != world_to_clip_size) {
+		world_to_clip_size = drawable_size;
+
 		float aspect = float(drawable_size.x) / float(drawable_size.y);
 
 		//want scale such that board * scale fits in [-aspect,aspect]x[-1.0,1.0] screen box:
 		float scale = glm::min(
-				2.0f * aspect / float(board_size.x),
-				2.0f / float(board_size.y)
+				2.0f * aspect / float(state.board_size.x),
+				2.0f / float(state.board_size.y)
 				);
 
 		//center of board will be placed at center of screen:
-		glm::vec2 center = 0.5f * glm::vec2(board_size);
+		glm::vec2 center = 0.5f * glm::vec2(state.board_size);
 
 		//NOTE: glm matrices are specified in column-major order
 		world_to_clip = glm::mat4(
@@ -507,48 +460,55 @@ void Game::draw(glm::uvec2 drawable_size) {
 				);
 	}
 
-	//set up graphics pipeline to use data from the meshes and the simple shading program:
-	glBindVertexArray(meshes_for_simple_shading_vao);
-	glUseProgram(simple_shading.program);
-
-	glUniform3fv(simple_shading.sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.81f, 0.81f, 0.76f)));
-	glUniform3fv(simple_shading.sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f))));
-	glUniform3fv(simple_shading.sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.3f)));
-	glUniform3fv(simple_shading.sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f)));
-
-	//helper function to draw a given mesh with a given transformation:
-	auto draw_mesh = [&](Mesh const &mesh, glm::mat4 const &object_to_world) {
-		//set up the matrix uniforms:
-		if (simple_shading.object_to_clip_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * object_to_world;
-			glUniformMatrix4fv(simple_shading.object_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
-		}
-		if (simple_shading.object_to_light_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(simple_shading.object_to_light_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_world));
-		}
-		if (simple_shading.normal_to_light_mat3 != -1U) {
-			//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
-			glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
-			glUniformMatrix3fv(simple_shading.normal_to_light_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_world));
+	{ //update the Frame uniform block, but only if the camera or lights have changed since it was last uploaded:
+		FrameUniforms frame;
+		frame.world_to_clip = world_to_clip;
+		frame.sun_direction = glm::vec4(lights.sun_direction, 0.0f);
+		frame.sun_color = glm::vec4(lights.sun_color, 0.0f);
+		frame.sky_direction = glm::vec4(lights.sky_direction, 0.0f);
+		frame.sky_color = glm::vec4(lights.sky_color, 0.0f);
+		if (!frame_uniforms_uploaded || std::memcmp(&frame, &frame_uniforms, sizeof(FrameUniforms)) != 0) {
+			frame_uniforms = frame;
+			frame_uniforms_uploaded = true;
+			glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame_uniforms);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
 		}
+	}
+
+	//how far between the previous step and the current one this frame falls:
+	// (no blending across a restart, since nothing carries over)
+	float alpha = glm::clamp(tick_accumulator * tick_rate, 0.0f, 1.0f);
+	if (previous.resets != state.resets) alpha = 1.0f;
 
-		//draw the mesh:
-		glDrawArrays(GL_TRIANGLES, mesh.first, mesh.count);
+	glm::vec2 duck = glm::mix(previous.duck, glm::vec2(state.duck_pos[3][0], state.height), alpha);
+	glm::mat4 duck_pos = glm::mat4(
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			duck.x, duck.y, 0.0f, 0.0f);
+	glm::mat4 cursor_rotation = glm::mat4_cast(glm::angleAxis(
+			glm::radians(-glm::mix(previous.cursor, state.cursor, alpha)), glm::vec3(0.0f, 0.0f, 1.0f)));
+	float power = glm::mix(previous.power, state.power, alpha);
+
+	//helper function to queue a given mesh with a given transformation (at a level of detail that suits its size on screen):
+	auto draw_mesh = [&](RenderQueue::Pass pass, Mesh const &mesh, glm::mat4 const &object_to_world) {
+		render_queue.add(pass, simple_shading_pipeline, mesh, object_to_world, pick_lod(mesh, object_to_world));
 	};
 
-	draw_mesh(bg_mesh, glm::mat4(
+	draw_mesh(RenderQueue::BackgroundPass, bg_mesh, glm::mat4(
 				1.0f, 0.0f, 0.0f, 0.0f,
 				0.0f, 1.0f, 0.0f, 0.0f,
 				0.0f, 0.0f, 1.0f, 0.0f,
 				0.0, 0.0f, 0.0f, 1.0f));
 
-	if(gameOver){
-		draw_mesh(game_over_mesh, glm::mat4(
+	if(state.gameOver){
+		draw_mesh(RenderQueue::ObjectsPass, game_over_mesh, glm::mat4(
 					1.0f, 0.0f, 0.0f, 0.0f,
 					0.0f, 1.0f, 0.0f, 0.0f,
 					0.0f, 0.0f, 1.0f, 0.0f,
 					0.0, 0.0f, 0.0f, 1.0f));
-		draw_mesh(restart_mesh, glm::mat4(
+		draw_mesh(RenderQueue::ObjectsPass, restart_mesh, glm::mat4(
 					1.0f, 0.0f, 0.0f, 0.0f,
 					0.0f, 1.0f, 0.0f, 0.0f,
 					0.0f, 0.0f, 1.0f, 0.0f,
@@ -557,22 +517,22 @@ void Game::draw(glm::uvec2 drawable_size) {
 	}else{
 
 
-		if(controls.up || controls.right || controls.left){
-			draw_mesh(cursor_mesh, //white jump bar
+		if(state.controls.up || state.controls.right || state.controls.left){
+			draw_mesh(RenderQueue::ObjectsPass, cursor_mesh, //white jump bar
 					glm::mat4(
 						1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 1.0f, 0.0f, 0.0f,
 						0.0f, 0.0f, 1.0f, 0.0f,
 						0.0f, 0.3f, 0.0f, 1.0f
-						)*glm::mat4_cast(cursor_rotation) //jump angle
+						)*cursor_rotation //jump angle
 					+duck_pos);
 
-			draw_mesh(cursor_mesh_red, glm::mat4( //red jump bar
+			draw_mesh(RenderQueue::ObjectsPass, cursor_mesh_red, glm::mat4( //red jump bar
 						1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 1.0f, 0.0f, 0.0f,
 						0.0f, 0.0f, 1.0f, 0.0f,
 						0.0f, 0.3f, 0.0f, 1.0f
-						)*glm::mat4_cast(cursor_rotation) //jump angle
+						)*cursor_rotation //jump angle
 					*glm::mat4(
 						1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 1.0f+0.6f*power, 0.0f, 0.0f,
@@ -581,48 +541,153 @@ void Game::draw(glm::uvec2 drawable_size) {
 		}
 
 		//draw all the targets
-		for(uint32_t i = 0; i<targets.size(); i++){
-			draw_mesh(target_mesh, targets[i]);
+		for(uint32_t i = 0; i<state.targets.size(); i++){
+			draw_mesh(RenderQueue::ObjectsPass, target_mesh, state.targets[i]);
 		}
 
-		draw_mesh(duck_mesh, glm::mat4(
+		draw_mesh(RenderQueue::ObjectsPass, duck_mesh, glm::mat4(
 					1.0f, 0.0f, 0.0f, 0.0f,
 					0.0f, 1.0f, 0.0f, 0.0f,
 					0.0f, 0.0f, 1.0f, 0.0f,
 					0.0, 0.5f, 0.0f, 1.0f)+ (duck_pos));
 
-		for(uint32_t i = 0; i < board_translations.size(); i++){
-			draw_mesh(enemy_mesh,
+		for(uint32_t i = 0; i < state.geese.size(); i++){
+			glm::vec2 at = glm::vec2(state.geese.x[i], state.geese.y[i]);
+			if (i < previous.geese_x.size()) { //(geese spawned during the last step are just drawn where they are)
+				at = glm::mix(glm::vec2(previous.geese_x[i], previous.geese_y[i]), at, alpha);
+			}
+			draw_mesh(RenderQueue::ObjectsPass, enemy_mesh,
 					glm::mat4(
 						1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 1.0f, 0.0f, 0.0f,
 						0.0f, 0.0f, 1.0f, 0.0f,
-						0.5f, 0.5f, 0.0f, 1.0f
-						) + board_translations[i]
+						0.5f + at.x, 0.5f + at.y, 0.0f, 1.0f
+						)
 				 );
 		}
 
-		uint32_t remainder = score;
+		//draw the score, one digit at a time:
+		uint32_t remainder = state.score;
 		float xcoord = 3.8f;
 		do{
-			int digit = remainder%10;
-			draw_mesh(numbers[digit],
+			draw_mesh(RenderQueue::HUDPass, numbers[remainder%10],
 					glm::mat4(
 						1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 1.0f, 0.0f, 0.0f,
 						0.0f, 0.0f, 1.0f, 0.0f,
 						xcoord, 2.5f, 0.0f, 1.0f));
-
 			remainder /= 10;
 			xcoord -= 0.1f;
 		}while(remainder>0);
 	}
-	glUseProgram(0);
+
+	if (perf_hud.visible) {
+		draw_perf_hud();
+	}
+
+	//sort, batch, and draw everything queued above:
+	render_queue.submit();
 
 	GL_ERRORS();
 }
 
 
+uint32_t Game::pick_lod(Mesh const &mesh, glm::mat4 const &object_to_world) const {
+	if (mesh.lod_count == 0 || lod_pixel_error <= 0.0f) return 0;
+
+	//pixels per world unit near the mesh (the most along x or y, so anisotropic views are covered):
+	glm::vec3 center = 0.5f * (mesh.min + mesh.max);
+	glm::vec4 clip = world_to_clip * (object_to_world * glm::vec4(center, 1.0f));
+	if (clip.w <= 0.0f) return 0; //(behind a perspective camera)
+	glm::vec3 row_x = glm::vec3(world_to_clip[0][0], world_to_clip[1][0], world_to_clip[2][0]);
+	glm::vec3 row_y = glm::vec3(world_to_clip[0][1], world_to_clip[1][1], world_to_clip[2][1]);
+	float pixels_per_unit = std::max(
+		glm::length(row_x) * 0.5f * float(world_to_clip_size.x),
+		glm::length(row_y) * 0.5f * float(world_to_clip_size.y)) / clip.w;
+
+	//world units per object unit (the largest scale of the transform, so errors are never underestimated):
+	float object_scale = std::max(glm::length(glm::vec3(object_to_world[0])),
+		std::max(glm::length(glm::vec3(object_to_world[1])), glm::length(glm::vec3(object_to_world[2]))));
+
+	uint32_t lod = 0;
+	for (uint32_t l = 0; l < mesh.lod_count; ++l) {
+		if (mesh.lods[l].error * object_scale * pixels_per_unit > lod_pixel_error) break;
+		lod = l + 1;
+	}
+	return lod;
+}
+
+void Game::draw_perf_hud() {
+	//place 'mesh' so its bounding box covers [at, at+size] in x and y, in front of everything else:
+	// (depth is scaled down along with x and y, so the mesh stays close to z = 0.9)
+	auto fit = [](Mesh const &mesh, glm::vec2 at, glm::vec2 size) -> glm::mat4 {
+		glm::vec2 extent = glm::max(glm::vec2(mesh.max.x - mesh.min.x, mesh.max.y - mesh.min.y), glm::vec2(1e-6f));
+		glm::vec2 scale = size / extent;
+		float scale_z = std::min(scale.x, scale.y);
+		return glm::mat4(
+			scale.x, 0.0f, 0.0f, 0.0f,
+			0.0f, scale.y, 0.0f, 0.0f,
+			0.0f, 0.0f, scale_z, 0.0f,
+			at.x - scale.x * mesh.min.x, at.y - scale.y * mesh.min.y, 0.9f - scale_z * mesh.max.z, 1.0f
+		);
+	};
+	auto draw = [&](Mesh const &mesh, glm::vec2 at, glm::vec2 size) {
+		glm::mat4 object_to_world = fit(mesh, at, size);
+		render_queue.add(RenderQueue::HUDPass, simple_shading_pipeline, mesh, object_to_world, pick_lod(mesh, object_to_world));
+	};
+
+	glm::vec2 const corner = glm::vec2(0.05f, 3.9f); //top left of the overlay
+	float const row = 0.13f; //height of a row of digits (plus spacing)
+
+	//frame time graph, oldest frame first:
+	float const graph_height = 0.5f;
+	for (uint32_t i = 0; i < perf_hud.Frames; ++i) {
+		float ms = perf_hud.frame_ms[(perf_hud.next + i) % perf_hud.Frames];
+		float height = graph_height * glm::clamp(ms / (1000.0f / 30.0f), 0.01f, 1.0f);
+		draw(ms > 1000.0f / 60.0f ? cursor_mesh_red : cursor_mesh,
+			glm::vec2(corner.x + 0.02f * i, corner.y - graph_height), glm::vec2(0.012f, height));
+	}
+
+	//numbers, one per row:
+	auto draw_number = [&](uint32_t value, glm::vec2 at) {
+		uint32_t digits[10];
+		uint32_t count = 0;
+		do {
+			digits[count++] = value % 10;
+			value /= 10;
+		} while (value > 0);
+		for (uint32_t d = 0; d < count; ++d) {
+			Mesh const &digit = numbers[digits[count - 1 - d]];
+			float height = 0.1f;
+			float width = height * (digit.max.x - digit.min.x) / std::max(1e-6f, digit.max.y - digit.min.y);
+			draw(digit, at + glm::vec2(0.065f * d, 0.0f), glm::vec2(width, height));
+		}
+	};
+
+	float average_ms = 0.0f;
+	for (float ms : perf_hud.frame_ms) average_ms += ms;
+	average_ms /= float(perf_hud.Frames);
+
+	glm::vec2 at = corner - glm::vec2(0.0f, graph_height + row);
+	glm::vec2 const label = glm::vec2(0.12f, 0.0f); //(numbers with an icon start after it)
+
+	draw_number(uint32_t(average_ms * 1000.0f), at); at.y -= row;
+	draw_number(uint32_t(perf_hud.tick_ms * 1000.0f), at); at.y -= row;
+	draw_number(render_queue.submitted_draws, at); at.y -= row;
+	draw_number(render_queue.submitted_vertices, at); at.y -= row;
+
+	draw(enemy_mesh, at, glm::vec2(0.1f, 0.1f));
+	draw_number(state.geese.size(), at + label); at.y -= row;
+
+	draw(target_mesh, at, glm::vec2(0.1f, 0.1f));
+	draw_number(uint32_t(state.targets.size()), at + label); at.y -= row;
+
+	if (gpu_timers.enabled && gpu_timers.samples() > 0) {
+		draw_number(uint32_t(gpu_timers.frame_stats().avg * 1000.0f), at); at.y -= row;
+	}
+}
+
+
 
 //create and return an OpenGL vertex shader from source:
 static GLuint compile_shader(GLenum type, std::string const &source) {
@@ -646,3 +711,27 @@ static GLuint compile_shader(GLenum type, std::string const &source) {
 	}
 	return shader;
 }
+
+//create and return an OpenGL program from a vertex and fragment shader:
+static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader) {
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+
+	//link the shader program and throw errors if linking fails:
+	glLinkProgram(program);
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		std::cerr << "Failed to link shader program." << std::endl;
+		GLint info_log_length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length, 0);
+		GLsizei length = 0;
+		glGetProgramInfoLog(program, GLsizei(info_log.size()), &length, &info_log[0]);
+		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
+		glDeleteProgram(program);
+		throw std::runtime_error("failed to link program");
+	}
+	return program;
+}
@@ -1,21 +1,30 @@
 #pragma once
 
 #include "GL.hpp"
+#include "Mesh.hpp"
+#include "MeshLoader.hpp"
+#include "RenderQueue.hpp"
+#include "GameState.hpp"
+#include "Replay.hpp"
+#include "GpuTimers.hpp"
 
 #include <SDL.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include <vector>
-#include <random>
+#include <memory>
+#include <set>
+#include <string>
 
-// The 'Game' struct holds all of the game-relevant state,
+// The 'Game' struct connects the game's simulation (GameState) to SDL input and OpenGL drawing,
 // and is called by the main loop.
 
 struct Game {
 	//Game creates OpenGL resources (i.e. vertex buffer objects) in its
 	//constructor and frees them in its destructor.
-	Game();
+	//'seed' seeds the game's random number generator (see GameState).
+	Game(uint64_t seed);
 	~Game();
 
 	//handle_event is called when new mouse or keyboard events are received:
@@ -23,32 +32,28 @@ struct Game {
 	//The function should return 'true' if it handled the event.
 	bool handle_event(SDL_Event const &evt, glm::uvec2 window_size);
 
-	void check_targets();
-	void add_target();
-	void check_enemies();
-	void enemies_collision(uint32_t i);
+	//inputs go through act(), so they can be recorded:
+	void act(GameState::Action action, bool pressed);
 
 	//update is called at the start of a new frame, after events are handled
+	// (advances 'state' in fixed steps -- see below -- once meshes have loaded)
 	void update(float elapsed);
 
 	//draw is called after update:
 	void draw(glm::uvec2 drawable_size);
 	void draw_score();
+	void draw_perf_hud(); //(queues the overlay described below)
 
 	//------- opengl resources -------
 
 	//shader program that draws lit objects with vertex colors:
+	// each draw renders one or more copies of a mesh, with per-copy transforms read from a buffer texture (see RenderQueue)
 	struct {
 		GLuint program = -1U; //program object
 
 		//uniform locations:
-		GLuint object_to_clip_mat4 = -1U;
-		GLuint object_to_light_mat4x3 = -1U;
-		GLuint normal_to_light_mat3 = -1U;
-		GLuint sun_direction_vec3 = -1U;
-		GLuint sun_color_vec3 = -1U;
-		GLuint sky_direction_vec3 = -1U;
-		GLuint sky_color_vec3 = -1U;
+		GLuint transforms_samplerBuffer = -1U;
+		GLuint first_transform_int = -1U;
 
 		//attribute locations:
 		GLuint Position_vec4 = -1U;
@@ -56,15 +61,60 @@ struct Game {
 		GLuint Color_vec4 = -1U;
 	} simple_shading;
 
-	//mesh data, stored in a vertex buffer:
-	GLuint meshes_vbo = -1U; //vertex buffer holding mesh data
+	//simple_shading reads camera and lights from a std140 uniform block,
+	// backed by a buffer attached to a fixed binding point:
+	enum : GLuint {
+		FrameUniformsBinding = 0,
+	};
 
-	//The location of each mesh in the meshes vertex buffer:
-	struct Mesh {
-		GLint first = 0;
-		GLsizei count = 0;
+	//"Frame" block: camera and lights; only re-uploaded when something in it changes.
+	// (std140 pads each vec3 to a vec4)
+	struct FrameUniforms {
+		glm::mat4 world_to_clip;
+		glm::vec4 sun_direction;
+		glm::vec4 sun_color;
+		glm::vec4 sky_direction;
+		glm::vec4 sky_color;
 	};
+	static_assert(sizeof(FrameUniforms) == 128, "FrameUniforms should match std140 layout.");
+
+	GLuint frame_ubo = -1U; //buffer backing the Frame block
+
+	FrameUniforms frame_uniforms; //last contents uploaded to frame_ubo
+	bool frame_uniforms_uploaded = false;
 
+	glm::mat4 world_to_clip; //fits the board to the window
+	glm::uvec2 world_to_clip_size = glm::uvec2(0); //drawable size world_to_clip was computed for
+
+	//meshes are drawn with their coarsest level of detail (see Mesh.hpp) that, placed by 'object_to_world'
+	// and projected by world_to_clip into world_to_clip_size pixels, is within lod_pixel_error pixels of
+	// the full mesh; returns the 'lod' argument for RenderQueue::add:
+	uint32_t pick_lod(Mesh const &mesh, glm::mat4 const &object_to_world) const;
+	float lod_pixel_error = 1.0f; //(0 always draws full meshes)
+
+	//mesh data, stored in a vertex buffer:
+	GLuint meshes_vbo = -1U; //vertex buffer holding mesh data
+	GLuint meshes_ibo = -1U; //element buffer holding 16-bit indices (only if the blob is indexed)
+
+	//meshes.blob is read by a loader thread (and stays mapped), and each mesh is only uploaded (to its
+	// place in meshes_vbo and meshes_ibo, which are sized for the whole blob) once it is ready:
+	std::unique_ptr< MeshLoader > mesh_loader;
+	uint32_t meshes_uploaded = 0; //of mesh_loader->meshes
+	bool meshes_ready = false; //every mesh the game draws is uploaded (until then, update and draw do nothing)
+	std::set< std::string > loaded_meshes; //names of meshes uploaded so far
+	size_t loaded_mesh_bytes = 0; //vertex and index data uploaded so far
+
+	//upload the meshes the loader has finished since the last call; returns meshes_ready:
+	// (update() calls this each frame)
+	bool poll_meshes();
+	//...or wait for all of them:
+	void wait_for_meshes();
+
+	//once meshes_ready, look up any mesh by name, uploading it if this is its first use; throws if there is no such mesh:
+	Mesh const &load_mesh(std::string const &name);
+	void upload_mesh(std::string const &name, Mesh const &mesh); //(copy a prepared mesh into meshes_vbo and meshes_ibo)
+
+	//The location of each mesh in the meshes vertex buffer (see Mesh.hpp):
 	Mesh tile_mesh;
 	Mesh cursor_mesh;
 	Mesh cursor_mesh_red;
@@ -79,36 +129,64 @@ struct Game {
 	
 	GLuint meshes_for_simple_shading_vao = -1U; //vertex array object that describes how to connect the meshes_vbo to the simple_shading_program
 
-	//------- game state -------
-	float const max_power = 4.0f;
-	float const min_r = 0.3f;
-
-	glm::uvec2 board_size = glm::uvec2(5,4);
-	std::vector< glm::mat4 > board_translations; //enemy movements
-	std::vector< glm::mat4 > targets;
-       	std::vector< float > bump; 
-		//enemies go opposite way for a bit after bumping one another
-	glm::quat cursor_rotation;
-	glm::mat4 duck_pos;
-
-	float power = 0.0f; //should only be between 0 and 1
-	bool increase = true;
-	bool gameOver = false;
-	bool restart = false;
-	int32_t cursor = 0; //should only be between -90 and 90
-	float speed = 0.5f; //enemy speed
-	uint32_t score = 0;
-
-	float height = 0.0f; //ducks height
-	float xpos = 0.0f; //ducks horizontal position 
-	glm::vec2 velocity = glm::vec2(0.0f, 0.0f);
+	//draws meshes_vbo with simple_shading:
+	RenderQueue::Pipeline simple_shading_pipeline;
+
+	//Game::draw() queues everything to be drawn here, then submits it all at once:
+	RenderQueue render_queue;
 
+	//GPU time per render pass (main.cpp marks the start and end of each frame; the queue marks each pass):
+	GpuTimers gpu_timers;
+
+	//performance overlay, toggled with F1 and drawn in the top left with the HUD:
+	// a graph of recent frame times (white bars, red when over 1/60 s; full height is 1/30 s),
+	// then one number per row: frame time (us), simulation step time (us), draw calls, vertices,
+	// geese (next to a goose), eggs (next to an egg), and -- when gpu_timers is enabled -- GPU frame time (us).
+	//(drawn through render_queue, so each kind of mesh costs one instanced draw)
+	struct {
+		bool visible = false;
+		enum : uint32_t { Frames = 64 };
+		float frame_ms[Frames] = {}; //recent frame times; the oldest is at 'next'
+		uint32_t next = 0;
+		float tick_ms = 0.0f; //average time of GameState::update in the latest update that took any steps
+	} perf_hud;
+
+	//lighting (changing these updates the Frame block on the next draw):
 	struct {
-		bool left = false;
-		bool right = false;
-		bool up = false;
-		bool down = false;
-		bool jump = false;
-	} controls;
+		glm::vec3 sun_direction = glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f));
+		glm::vec3 sun_color = glm::vec3(0.81f, 0.81f, 0.76f);
+		glm::vec3 sky_direction = glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 sky_color = glm::vec3(0.2f, 0.2f, 0.3f);
+	} lights;
 
+	//------- game state -------
+	GameState state;
+
+	//state advances in fixed steps of 1/tick_rate seconds, however long frames take,
+	// so play (and replays) don't depend on frame rate; draw() blends the last two steps:
+	float tick_rate = 120.0f; //steps per second
+	float max_lag = 0.25f; //at most this much time is simulated per update (so a stall doesn't cause a burst of steps)
+	float tick_accumulator = 0.0f; //time not yet simulated (less than one step after update)
+
+	struct {
+		glm::vec2 duck = glm::vec2(0.0f);
+		float cursor = 0.0f;
+		float power = 0.0f;
+		std::vector< float > geese_x, geese_y;
+		uint32_t resets = 0;
+	} previous; //parts of 'state' that are drawn, as they were before the last step
+
+	uint64_t ticks = 0; //steps taken so far
+
+	//------- replays -------
+	//every input is recorded (along with the seed) so the session can be played again:
+	Replay recording;
+	//write 'recording' (up to the current step) to a file; throws on failure:
+	void save_recording(std::string const &filename);
+
+	//take inputs from 'replay' instead of the keyboard (nullptr to stop);
+	// the game should have been constructed with the replay's seed, and nothing simulated yet:
+	void play(Replay const *replay);
+	Replay const *playback = nullptr;
+	size_t playback_next = 0; //next input of 'playback' to apply
 };
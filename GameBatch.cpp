@@ -0,0 +1,188 @@
+#include "GameBatch.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+GameBatch::GameBatch(uint32_t count, uint32_t threads, float tick_rate_) : tick_rate(tick_rate_) {
+	if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+	threads = std::max(1U, std::min(threads, count));
+
+	games.resize(count);
+	held.assign(count, 0);
+	observations.assign(size_t(count) * ObservationSize, 0.0f);
+	rewards.assign(count, 0.0f);
+	done.assign(count, 0);
+
+	workers.reserve(threads - 1);
+	for (uint32_t w = 0; w + 1 < threads; ++w) {
+		workers.emplace_back(&GameBatch::worker_main, this, w + 1);
+	}
+}
+
+GameBatch::~GameBatch() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	start_cv.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void GameBatch::reset(uint64_t const *seeds) {
+	assert(seeds || games.empty());
+	job_seeds = seeds;
+	run(ResetJob);
+	job_seeds = nullptr;
+}
+
+void GameBatch::step(uint8_t const *actions) {
+	assert(actions || games.empty());
+	assert(std::all_of(games.begin(), games.end(), [](std::unique_ptr< GameState > const &g){ return bool(g); }) && "reset() before step()");
+	job_actions = actions;
+	run(StepJob);
+	job_actions = nullptr;
+}
+
+void GameBatch::run(Job job_) {
+	job = job_;
+	if (!workers.empty()) {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			generation += 1;
+			busy = uint32_t(workers.size());
+		}
+		start_cv.notify_all();
+	}
+
+	run_shard(0);
+
+	if (!workers.empty()) {
+		std::unique_lock< std::mutex > lock(mutex);
+		done_cv.wait(lock, [this](){ return busy == 0; });
+	}
+}
+
+void GameBatch::worker_main(uint32_t shard) {
+	if (Profiler::enabled()) Profiler::set_thread_name("GameBatch worker " + std::to_string(shard));
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			start_cv.wait(lock, [this,seen](){ return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+
+		run_shard(shard);
+
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			busy -= 1;
+			if (busy == 0) done_cv.notify_one();
+		}
+	}
+}
+
+void GameBatch::run_shard(uint32_t shard) {
+	PROFILE_SCOPE(job == ResetJob ? "GameBatch reset" : "GameBatch step");
+	uint64_t shards = workers.size() + 1;
+	uint32_t begin = uint32_t(games.size() * shard / shards);
+	uint32_t end = uint32_t(games.size() * (shard + 1) / shards);
+
+	if (job == ResetJob) {
+		for (uint32_t i = begin; i < end; ++i) {
+			games[i].reset(new GameState(job_seeds[i]));
+			held[i] = 0;
+			rewards[i] = 0.0f;
+			done[i] = 0;
+			observe(i);
+		}
+	} else if (job == StepJob) {
+		float tick = 1.0f / tick_rate;
+		for (uint32_t i = begin; i < end; ++i) {
+			GameState &game = *games[i];
+
+			//buttons that changed since the last step become presses and releases:
+			uint8_t changed = uint8_t(held[i] ^ job_actions[i]);
+			for (uint32_t a = GameState::ActionLeft; a <= GameState::ActionRestart; ++a) {
+				if (changed & (1 << a)) {
+					game.handle_action(GameState::Action(a), (job_actions[i] & (1 << a)) != 0);
+				}
+			}
+			held[i] = job_actions[i];
+
+			uint32_t resets = game.resets;
+			uint32_t score = game.score;
+			game.update(tick);
+			rewards[i] = (game.resets == resets ? float(game.score - score) : 0.0f);
+			done[i] = game.gameOver ? 1 : 0;
+			observe(i);
+		}
+	}
+}
+
+void GameBatch::observe(uint32_t i) {
+	GameState const &game = *games[i];
+	float *obs = &observations[size_t(i) * ObservationSize];
+	std::fill(obs, obs + ObservationSize, 0.0f);
+
+	glm::vec2 duck = glm::vec2(game.duck_pos[3][0], game.height);
+	obs[0] = duck.x;
+	obs[1] = duck.y;
+	obs[2] = game.velocity.x;
+	obs[3] = game.velocity.y;
+	obs[4] = game.cursor / 90.0f;
+	obs[5] = game.power / game.max_power;
+	obs[6] = game.controls.jump ? 1.0f : 0.0f;
+	obs[7] = game.gameOver ? 1.0f : 0.0f;
+	obs[8] = float(game.score);
+
+	//keep the 'N' nearest of 'count' things, by inserting each into a short sorted list:
+	// (fixed-size, so nothing is allocated)
+	struct Near {
+		float dist2;
+		uint32_t index;
+	};
+	auto nearest = [&duck](uint32_t count, Near *list, uint32_t N, glm::vec2 (*at)(GameState const &, uint32_t), GameState const &g) {
+		uint32_t found = 0;
+		for (uint32_t t = 0; t < count; ++t) {
+			glm::vec2 d = at(g, t) - duck;
+			Near near{d.x * d.x + d.y * d.y, t};
+			if (found == N && near.dist2 >= list[N-1].dist2) continue;
+			uint32_t j = (found < N ? found++ : N - 1);
+			while (j > 0 && list[j-1].dist2 > near.dist2) {
+				list[j] = list[j-1];
+				--j;
+			}
+			list[j] = near;
+		}
+		return found;
+	};
+
+	Near targets[ObservedTargets];
+	uint32_t target_count = nearest(uint32_t(game.targets.size()), targets, ObservedTargets, [](GameState const &g, uint32_t t){
+		return glm::vec2(g.targets[t][3][0], g.targets[t][3][1]);
+	}, game);
+	for (uint32_t t = 0; t < target_count; ++t) {
+		float *o = obs + TargetsOffset + 3 * t;
+		o[0] = game.targets[targets[t].index][3][0] - duck.x;
+		o[1] = game.targets[targets[t].index][3][1] - duck.y;
+		o[2] = 1.0f;
+	}
+
+	Near geese[ObservedGeese];
+	uint32_t goose_count = nearest(game.geese.size(), geese, ObservedGeese, [](GameState const &g, uint32_t t){
+		return glm::vec2(g.geese.x[t], g.geese.y[t]);
+	}, game);
+	for (uint32_t t = 0; t < goose_count; ++t) {
+		float *o = obs + GeeseOffset + 4 * t;
+		o[0] = game.geese.x[geese[t].index] - duck.x;
+		o[1] = game.geese.y[geese[t].index] - duck.y;
+		o[2] = game.geese.bump[geese[t].index] > 0.0f ? 1.0f : 0.0f;
+		o[3] = 1.0f;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "GameState.hpp"
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+//GameBatch steps many independent games at once (e.g., for training or balancing bots).
+//Games are split into one contiguous shard per thread; the calling thread works on the first
+// shard while a pool of worker threads (started once, in the constructor) handles the rest.
+//
+//All results live in flat arrays owned by the batch, which step() overwrites in place,
+// so stepping allocates nothing (GameState itself reuses its scratch space between steps):
+//
+//   GameBatch batch(4096);
+//   batch.reset(seeds.data());
+//   while (...) {
+//     //fill actions[i] with a bitmask of held buttons for each game, then:
+//     batch.step(actions.data());
+//     //read batch.observations, batch.rewards, batch.done
+//   }
+
+struct GameBatch {
+	//'threads' counts the calling thread; zero means one per core:
+	GameBatch(uint32_t count, uint32_t threads = 0, float tick_rate = 120.0f);
+	~GameBatch();
+
+	GameBatch(GameBatch const &) = delete;
+	GameBatch &operator=(GameBatch const &) = delete;
+
+	//start a new game in every slot, game i seeded with seeds[i]:
+	void reset(uint64_t const *seeds);
+
+	//actions are the buttons held during a step; changes from the previous step become GameState actions:
+	enum : uint8_t {
+		HoldLeft = (1 << GameState::ActionLeft),
+		HoldRight = (1 << GameState::ActionRight),
+		HoldJump = (1 << GameState::ActionJump), //(jumps when released)
+		HoldRestart = (1 << GameState::ActionRestart), //(only does something once the game is over)
+	};
+
+	//advance every game by one step, with game i holding actions[i]:
+	void step(uint8_t const *actions);
+
+	//each game's observation is ObservationSize floats, starting at observations[i * ObservationSize]:
+	// 0: duck x, 1: duck height, 2-3: duck velocity, 4: jump angle (-1 to 1), 5: jump power (0 to 1),
+	// 6: jumping (0/1), 7: game over (0/1), 8: score,
+	// then (dx, dy, present) from the duck to each of the nearest ObservedTargets targets,
+	// then (dx, dy, fleeing, present) from the duck to each of the nearest ObservedGeese geese
+	// (nearest first; slots past the last target or goose are all zero):
+	enum : uint32_t {
+		ObservedTargets = 8,
+		ObservedGeese = 8,
+		TargetsOffset = 9,
+		GeeseOffset = TargetsOffset + 3 * ObservedTargets,
+		ObservationSize = GeeseOffset + 4 * ObservedGeese,
+	};
+	std::vector< float > observations;
+	std::vector< float > rewards; //points scored during the last step
+	std::vector< uint8_t > done; //1 if the game is over (hold HoldRestart, or reset(), to play again)
+
+	uint32_t size() const { return uint32_t(games.size()); }
+
+	float tick_rate;
+	std::vector< std::unique_ptr< GameState > > games; //(separate allocations, so threads don't share cache lines)
+	std::vector< uint8_t > held; //buttons held during the previous step
+
+	//------- internals -------
+	void observe(uint32_t i);
+
+	//run 'job' on every shard (the calling thread takes shard 0) and wait for all of them:
+	enum Job : uint8_t { ResetJob, StepJob };
+	void run(Job job);
+	void run_shard(uint32_t shard);
+	void worker_main(uint32_t shard);
+
+	Job job = StepJob;
+	uint64_t const *job_seeds = nullptr;
+	uint8_t const *job_actions = nullptr;
+
+	std::vector< std::thread > workers; //worker w runs shard w+1
+	std::mutex mutex;
+	std::condition_variable start_cv; //signaled when generation changes (or quit is set)
+	std::condition_variable done_cv; //signaled when busy reaches zero
+	uint64_t generation = 0; //incremented for each job
+	uint32_t busy = 0; //workers still running the current job
+	bool quit = false;
+};
@@ -0,0 +1,260 @@
+#include "GameState.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+
+GameState::GameState(uint64_t seed) : rng(seed) {
+	//set up game board:
+	duck_pos = glm::mat4(
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f);
+
+	populate();
+}
+
+void GameState::populate() {
+	//the first goose always starts in the same place; any others are scattered over the board:
+	geese.clear();
+	for(uint32_t i = 0; i<start_geese; i++){
+		if(i == 0){
+			geese.add(0.0f, 3.0f);
+		}else if(spawn_scale == 1.0f){
+			float newX = rng()%100/20.0f;
+			float newY = 1.0f + rng()%100/40.0f;
+			geese.add(newX, newY);
+		}else{
+			//(a larger area, at finer steps, so big populations don't pile up; see Stress::populate)
+			float newX = spawn_scale * 5.0f * float(rng()%65536) / 65536.0f;
+			float newY = 1.0f + spawn_scale * 2.5f * float(rng()%65536) / 65536.0f;
+			geese.add(newX, newY);
+		}
+	}
+
+	targets.clear();
+	for(uint32_t i = 0; i<start_targets; i++){
+		add_target();
+	}
+}
+
+void GameState::handle_action(Action action, bool pressed) {
+	//move duck jump angle and power
+	if (action == ActionLeft) {
+		controls.left = pressed;
+	} else if (action == ActionRight) {
+		controls.right = pressed;
+	} else if (action == ActionJump) {
+		controls.up = pressed;
+		if(controls.up == false && height == 0.0f) {
+			controls.jump = true;
+			velocity = glm::vec2(cursor/20.0f, 2.0*power);
+		}
+	} else if (action == ActionRestart) {
+		if(gameOver){
+			restart = true;
+		}
+	}
+}
+
+void GameState::add_target(){
+	float newX = rng()%100/20.0f;
+	float newY = rng()%100/28.0f;
+	while(newY<1.0f) newY = rng()%100/26.0f;
+	targets.emplace_back(glm::mat4(
+				1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				newX, newY, 0.0f, 1.0f));
+}
+
+void GameState::check_targets(){
+	//find the targets the duck is touching:
+	positions.clear();
+	for(uint32_t i = 0; i < targets.size(); i++){
+		positions.emplace_back(targets[i][3][0], targets[i][3][1]);
+	}
+	targets_grid.build(min_r, positions);
+
+	hits.clear();
+	targets_grid.query(glm::vec2(duck_pos[3][0], height), min_r, [this](uint32_t i){
+		hits.emplace_back(i);
+	});
+	if(hits.empty()) return;
+
+	//remove them all in one pass (keeping the rest in order), then replace each with a new one:
+	std::sort(hits.begin(), hits.end());
+	uint32_t kept = hits[0];
+	for(uint32_t i = hits[0], h = 0; i < targets.size(); i++){
+		if(h < hits.size() && hits[h] == i){ h++; continue; }
+		targets[kept++] = targets[i];
+	}
+	targets.resize(kept);
+	for(uint32_t i = 0; i < hits.size(); i++){
+		add_target();
+		score++;
+		//new enemy spawned for each points_per_goose points gained
+
+		if(points_per_goose && score%points_per_goose==0){
+			geese.add(0.0f, 3.0f);
+		}
+	}
+}
+
+void GameState::enemies_collision(float elapsed){
+	//every goose flees for a while longer for each goose it overlaps:
+	// (added one impulse at a time, so the result is exactly that of adding them as overlaps are found)
+	float impulse = bump_rate * elapsed;
+	geese_grid.count_neighbors(min_r, &neighbors);
+	for(uint32_t i = 0; i < neighbors.size(); i++){
+		float bump = geese.bump[i];
+		for(uint32_t n = 0; n < neighbors[i]; n++){
+			bump += impulse;
+		}
+		geese.bump[i] = bump;
+	}
+}
+
+void GameState::update(float elapsed) {
+	PROFILE_SCOPE("GameState::update");
+
+	//while the arrow keys are held, turn the jump angle; while space is held, swing the jump power up and down:
+	if (controls.left && cursor>-90.0f) {
+		cursor = std::max(-90.0f, cursor - cursor_speed * elapsed);
+	}else if (controls.right && cursor<90.0f) {
+		cursor = std::min(90.0f, cursor + cursor_speed * elapsed);
+	}else if (controls.up){
+		if(increase && power<max_power)
+			power = std::min(max_power, power + power_speed * elapsed);
+		else if(!increase && power>0.0f)
+			power = std::max(0.0f, power - power_speed * elapsed);
+
+		if(increase && power>=max_power) increase = false;
+		if(!increase && power<=0) increase = true;
+	}
+
+	if(controls.jump){
+		//referenced the discussion here
+		//https://gamedev.stackexchange.com/questions/15708/how-can-i-implement-gravity
+		//although i guess i did take ap physics c...
+		height += elapsed*(velocity.y+elapsed*-4.9f);
+		xpos += elapsed*velocity.x;
+		velocity.y += elapsed*-4.9;
+
+		if(xpos < -0.5f || xpos > 5.5f){
+			velocity.x *= -0.8f;
+		}
+
+		if(height > 3.6){
+			velocity.y = -2.0f;
+		}
+
+		//(only once falling: on the way up, the first step may not clear this height)
+		if(height<0.03f && velocity.y<0.0f){
+			height = 0.0f;
+			power = 0;
+			velocity.x = 0.0f;
+			controls.jump = false;
+		}
+		duck_pos = glm::mat4(
+				0.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 0.0f, 0.0f,
+				xpos, height, 0.0f, 0.0f);
+		PROFILE_SCOPE("check_targets");
+		check_targets();
+	}
+
+	//every goose chases the duck (or flees, while bumped), and is tested against the duck:
+	// (geese are tested from 0.4 to the right of their origin)
+	glm::vec2 duck = glm::vec2(duck_pos[3][0], height);
+	uint32_t touching;
+	{
+		PROFILE_SCOPE("Geese::chase");
+		touching = geese.chase(duck, chase_rate * speed * elapsed, elapsed, duck, glm::vec2(0.4f, 0.0f), min_r);
+	}
+	if(touching > 0){
+		gameOver = true;
+	}
+
+	//goose-goose collisions are found with a grid of everyone's new positions, rebuilt every tick:
+	{
+		PROFILE_SCOPE("geese_grid.build");
+		geese_grid.build(min_r, geese.x.data(), geese.y.data(), geese.size());
+	}
+	{
+		PROFILE_SCOPE("enemies_collision");
+		enemies_collision(elapsed);
+	}
+
+	if(restart){
+		PROFILE_SCOPE("restart");
+		resets += 1;
+		populate();
+	
+		gameOver = false;
+		restart = false;
+		cursor = 0.0f; //should only be between -90 and 90
+		score = 0;
+		
+		duck_pos = glm::mat4(
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f);
+		height = 0.0f; //ducks height
+		xpos = 0.0f; //ducks horizontal position 
+		velocity = glm::vec2(0.0f, 0.0f);
+	}
+
+}
+
+//64-bit FNV-1a, for GameState::hash():
+static void hash_bytes(uint64_t *h, void const *data, size_t size) {
+	uint8_t const *b = reinterpret_cast< uint8_t const * >(data);
+	for (size_t i = 0; i < size; ++i) {
+		*h = (*h ^ b[i]) * 0x100000001b3ULL;
+	}
+}
+template< typename T >
+static void hash_value(uint64_t *h, T const &v) {
+	hash_bytes(h, &v, sizeof(v));
+}
+template< typename T >
+static void hash_array(uint64_t *h, std::vector< T > const &v) {
+	hash_value(h, uint64_t(v.size()));
+	hash_bytes(h, v.data(), v.size() * sizeof(T));
+}
+
+uint64_t GameState::hash() const {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	hash_value(&h, rng.state);
+	hash_array(&h, geese.x);
+	hash_array(&h, geese.y);
+	hash_array(&h, geese.bump);
+	hash_array(&h, geese.state);
+	hash_array(&h, targets);
+	hash_value(&h, duck_pos);
+	hash_value(&h, power);
+	hash_value(&h, increase);
+	hash_value(&h, gameOver);
+	hash_value(&h, restart);
+	hash_value(&h, cursor);
+	hash_value(&h, speed);
+	hash_value(&h, start_targets);
+	hash_value(&h, start_geese);
+	hash_value(&h, points_per_goose);
+	hash_value(&h, spawn_scale);
+	hash_value(&h, score);
+	hash_value(&h, resets);
+	hash_value(&h, height);
+	hash_value(&h, xpos);
+	hash_value(&h, velocity);
+	hash_value(&h, controls.left);
+	hash_value(&h, controls.right);
+	hash_value(&h, controls.up);
+	hash_value(&h, controls.down);
+	hash_value(&h, controls.jump);
+	return h;
+}
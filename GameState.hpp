@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Geese.hpp"
+#include "Rng.hpp"
+#include "SpatialHash.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// The 'GameState' struct holds the Jump Duck simulation.
+// It doesn't use OpenGL or SDL, so it can be stepped without a window
+// (e.g., by tools and benchmarks); 'Game' draws it and feeds it input.
+
+struct GameState {
+	//the same seed (and the same inputs) always gives the same game:
+	GameState(uint64_t seed);
+
+	//player inputs:
+	enum Action : uint8_t {
+		ActionLeft, //rotate jump angle left (while held)
+		ActionRight, //rotate jump angle right (while held)
+		ActionJump, //charge jump power while held, jump on release
+		ActionRestart, //restart after game over
+	};
+	void handle_action(Action action, bool pressed);
+
+	//(re)place the starting geese and targets:
+	void populate();
+
+	void check_targets();
+	void add_target();
+	void enemies_collision(float elapsed); //(bumps every goose that overlaps another; uses geese_grid)
+
+	//advance the simulation by 'elapsed' seconds:
+	// (all rates below are per second, so results don't depend on how time is split into updates --
+	//  though they are only bit-for-bit reproducible with the same steps; see Game::update)
+	void update(float elapsed);
+
+	//fingerprint of everything that affects future steps (e.g., to check that a replay ends the same way):
+	uint64_t hash() const;
+
+	float const max_power = 4.0f;
+	float const min_r = 0.3f;
+
+	float const cursor_speed = 60.0f; //degrees per second the jump angle turns
+	float const power_speed = 6.0f; //jump power per second while charging
+	float const chase_rate = 0.15f; //fraction of the way to the duck a goose covers per second (times speed)
+	float const bump_rate = 120.0f; //seconds of fleeing per second two geese overlap
+
+	//populations (change these and call populate() to, e.g., stress test):
+	uint32_t start_targets = 7; //targets on the board (each one hit is replaced)
+	uint32_t start_geese = 1; //geese at the start of each game
+	uint32_t points_per_goose = 10; //another goose joins every this many points
+	float spawn_scale = 1.0f; //starting geese are scattered over this many times the width and height of the board
+
+	Rng rng; //all randomness (e.g., spawn positions) comes from here
+
+	glm::uvec2 board_size = glm::uvec2(5,4);
+	Geese geese; //enemies; go opposite way for a bit after bumping one another
+	std::vector< glm::mat4 > targets;
+	glm::mat4 duck_pos;
+
+	float power = 0.0f; //should only be between 0 and 1
+	bool increase = true;
+	bool gameOver = false;
+	bool restart = false;
+	float cursor = 0.0f; //jump angle in degrees; should only be between -90 and 90
+	float speed = 0.5f; //enemy speed
+	uint32_t score = 0;
+	uint32_t resets = 0; //number of restarts (lets renderers avoid interpolating across one)
+
+	float height = 0.0f; //ducks height
+	float xpos = 0.0f; //ducks horizontal position 
+	glm::vec2 velocity = glm::vec2(0.0f, 0.0f);
+
+	struct {
+		bool left = false;
+		bool right = false;
+		bool up = false;
+		bool down = false;
+		bool jump = false;
+	} controls;
+
+	//broadphase for collision checks (cells are min_r across):
+	SpatialHash geese_grid; //rebuilt every update (goose-goose; duck-goose is tested by Geese::chase; cost grows with geese per cell)
+	SpatialHash targets_grid; //rebuilt every check_targets
+	std::vector< glm::vec2 > positions; //(scratch space for building targets_grid)
+	std::vector< uint32_t > hits; //(scratch space for check_targets)
+	std::vector< uint32_t > neighbors; //(scratch space for enemies_collision)
+
+};
@@ -0,0 +1,169 @@
+#include "Geese.hpp"
+
+//chase() is vectorized with whichever of these the compiler is targeting:
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GEESE_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEESE_SSE 1
+#endif
+
+void Geese::add(float x_, float y_) {
+	x.emplace_back(x_);
+	y.emplace_back(y_);
+	bump.emplace_back(0.0f);
+	state.emplace_back(0);
+}
+
+void Geese::clear() {
+	x.clear();
+	y.clear();
+	bump.clear();
+	state.clear();
+}
+
+uint32_t Geese::chase_scalar(uint32_t begin, uint32_t end, glm::vec2 target, float fraction, float elapsed, glm::vec2 duck, glm::vec2 offset, float reach) {
+	float reach2 = reach * reach;
+	uint32_t touching = 0;
+	for (uint32_t i = begin; i < end; ++i) {
+		float dx = (target.x - x[i]) * fraction;
+		float dy = (target.y - y[i]) * fraction;
+
+		if (bump[i] > 0.0f) {
+			dx = -dx;
+			dy = -dy;
+			bump[i] -= elapsed;
+		}
+
+		x[i] += dx;
+		y[i] += dy;
+
+		float ex = (x[i] + offset.x) - duck.x;
+		float ey = (y[i] + offset.y) - duck.y;
+		if (ex * ex + ey * ey <= reach2) {
+			state[i] |= TouchingDuck;
+			touching += 1;
+		} else {
+			state[i] &= uint8_t(~TouchingDuck);
+		}
+	}
+	return touching;
+}
+
+//The vector versions below perform exactly the same float operations as chase_scalar, in the same order,
+// so every path gives bit-identical results (bump's sign flip and conditional subtract are done with masks).
+
+#if defined(GEESE_AVX)
+
+uint32_t Geese::chase(glm::vec2 target, float fraction, float elapsed, glm::vec2 duck, glm::vec2 offset, float reach) {
+	uint32_t count = size();
+	uint32_t touching = 0;
+
+	__m256 const target_x = _mm256_set1_ps(target.x), target_y = _mm256_set1_ps(target.y);
+	__m256 const frac = _mm256_set1_ps(fraction);
+	__m256 const el = _mm256_set1_ps(elapsed);
+	__m256 const duck_x = _mm256_set1_ps(duck.x), duck_y = _mm256_set1_ps(duck.y);
+	__m256 const offset_x = _mm256_set1_ps(offset.x), offset_y = _mm256_set1_ps(offset.y);
+	__m256 const reach2 = _mm256_set1_ps(reach * reach);
+	__m256 const zero = _mm256_setzero_ps();
+	__m256 const sign = _mm256_set1_ps(-0.0f);
+
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 px = _mm256_loadu_ps(&x[i]);
+		__m256 py = _mm256_loadu_ps(&y[i]);
+		__m256 b = _mm256_loadu_ps(&bump[i]);
+
+		__m256 dx = _mm256_mul_ps(_mm256_sub_ps(target_x, px), frac);
+		__m256 dy = _mm256_mul_ps(_mm256_sub_ps(target_y, py), frac);
+
+		__m256 bumped = _mm256_cmp_ps(b, zero, _CMP_GT_OQ);
+		dx = _mm256_xor_ps(dx, _mm256_and_ps(bumped, sign));
+		dy = _mm256_xor_ps(dy, _mm256_and_ps(bumped, sign));
+		b = _mm256_sub_ps(b, _mm256_and_ps(bumped, el));
+
+		px = _mm256_add_ps(px, dx);
+		py = _mm256_add_ps(py, dy);
+
+		_mm256_storeu_ps(&x[i], px);
+		_mm256_storeu_ps(&y[i], py);
+		_mm256_storeu_ps(&bump[i], b);
+
+		__m256 ex = _mm256_sub_ps(_mm256_add_ps(px, offset_x), duck_x);
+		__m256 ey = _mm256_sub_ps(_mm256_add_ps(py, offset_y), duck_y);
+		__m256 d2 = _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, reach2, _CMP_LE_OQ));
+		for (uint32_t k = 0; k < 8; ++k) {
+			if (mask & (1 << k)) {
+				state[i+k] |= TouchingDuck;
+				touching += 1;
+			} else {
+				state[i+k] &= uint8_t(~TouchingDuck);
+			}
+		}
+	}
+
+	return touching + chase_scalar(i, count, target, fraction, elapsed, duck, offset, reach);
+}
+
+#elif defined(GEESE_SSE)
+
+uint32_t Geese::chase(glm::vec2 target, float fraction, float elapsed, glm::vec2 duck, glm::vec2 offset, float reach) {
+	uint32_t count = size();
+	uint32_t touching = 0;
+
+	__m128 const target_x = _mm_set1_ps(target.x), target_y = _mm_set1_ps(target.y);
+	__m128 const frac = _mm_set1_ps(fraction);
+	__m128 const el = _mm_set1_ps(elapsed);
+	__m128 const duck_x = _mm_set1_ps(duck.x), duck_y = _mm_set1_ps(duck.y);
+	__m128 const offset_x = _mm_set1_ps(offset.x), offset_y = _mm_set1_ps(offset.y);
+	__m128 const reach2 = _mm_set1_ps(reach * reach);
+	__m128 const zero = _mm_setzero_ps();
+	__m128 const sign = _mm_set1_ps(-0.0f);
+
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 px = _mm_loadu_ps(&x[i]);
+		__m128 py = _mm_loadu_ps(&y[i]);
+		__m128 b = _mm_loadu_ps(&bump[i]);
+
+		__m128 dx = _mm_mul_ps(_mm_sub_ps(target_x, px), frac);
+		__m128 dy = _mm_mul_ps(_mm_sub_ps(target_y, py), frac);
+
+		__m128 bumped = _mm_cmpgt_ps(b, zero);
+		dx = _mm_xor_ps(dx, _mm_and_ps(bumped, sign));
+		dy = _mm_xor_ps(dy, _mm_and_ps(bumped, sign));
+		b = _mm_sub_ps(b, _mm_and_ps(bumped, el));
+
+		px = _mm_add_ps(px, dx);
+		py = _mm_add_ps(py, dy);
+
+		_mm_storeu_ps(&x[i], px);
+		_mm_storeu_ps(&y[i], py);
+		_mm_storeu_ps(&bump[i], b);
+
+		__m128 ex = _mm_sub_ps(_mm_add_ps(px, offset_x), duck_x);
+		__m128 ey = _mm_sub_ps(_mm_add_ps(py, offset_y), duck_y);
+		__m128 d2 = _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(d2, reach2));
+		for (uint32_t k = 0; k < 4; ++k) {
+			if (mask & (1 << k)) {
+				state[i+k] |= TouchingDuck;
+				touching += 1;
+			} else {
+				state[i+k] &= uint8_t(~TouchingDuck);
+			}
+		}
+	}
+
+	return touching + chase_scalar(i, count, target, fraction, elapsed, duck, offset, reach);
+}
+
+#else
+
+uint32_t Geese::chase(glm::vec2 target, float fraction, float elapsed, glm::vec2 duck, glm::vec2 offset, float reach) {
+	return chase_scalar(0, size(), target, fraction, elapsed, duck, offset, reach);
+}
+
+#endif
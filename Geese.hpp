@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//Geese (the enemies) are stored as parallel arrays ("structure of arrays"),
+// so the per-tick update streams through densely-packed floats and can be vectorized.
+
+struct Geese {
+	std::vector< float > x; //position
+	std::vector< float > y;
+	std::vector< float > bump; //while positive, goose flees instead of chasing (counts down in seconds)
+	std::vector< uint8_t > state; //per-goose flags (see below)
+
+	enum : uint8_t {
+		TouchingDuck = 1, //set by chase() when the goose is within reach of the duck
+	};
+
+	uint32_t size() const { return uint32_t(x.size()); }
+	void add(float x, float y);
+	void clear();
+
+	//move every goose by (target - position) * fraction (or the opposite way while bumped),
+	// count down bump timers, then flag geese within 'reach' of 'duck' (measured from
+	// 'offset' relative to the goose's position).
+	//Returns the number of geese touching the duck.
+	//Uses AVX or SSE when compiled for them (with a scalar loop for the remainder);
+	// results are identical to chase_scalar().
+	uint32_t chase(glm::vec2 target, float fraction, float elapsed, glm::vec2 duck, glm::vec2 offset, float reach);
+
+	//plain C++ version of chase() for a range of geese (used for the remainder, and as fallback):
+	uint32_t chase_scalar(uint32_t begin, uint32_t end, glm::vec2 target, float fraction, float elapsed, glm::vec2 duck, glm::vec2 offset, float reach);
+};
@@ -0,0 +1,131 @@
+#include "GpuTimers.hpp"
+
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+GpuTimers::~GpuTimers() {
+	if (created) {
+		for (QuerySet &set : sets) {
+			glDeleteQueries(SectionCount + 1, set.queries);
+		}
+	}
+}
+
+char const *GpuTimers::section_name(Section section) {
+	switch (section) {
+		case Clear: return "clear";
+		case Background: return "background";
+		case Objects: return "objects";
+		case HUD: return "HUD";
+		default: return "?";
+	}
+}
+
+void GpuTimers::begin_frame() {
+	if (!enabled) return;
+	if (!created) {
+		for (QuerySet &set : sets) {
+			glGenQueries(SectionCount + 1, set.queries);
+		}
+		created = true;
+	}
+
+	collect();
+
+	//if the GPU is so far behind that the next set is still in use, skip timing this frame rather than wait:
+	QuerySet &set = sets[current];
+	if (set.pending) {
+		recording = false;
+		return;
+	}
+	recording = true;
+	set.marked_count = 0;
+	mark(Clear);
+}
+
+void GpuTimers::mark(Section section) {
+	if (!enabled || !recording) return;
+	assert(section < SectionCount);
+	QuerySet &set = sets[current];
+	if (set.marked_count >= SectionCount) return; //(a section marked twice; keep the slot for end_frame)
+	glQueryCounter(set.queries[set.marked_count], GL_TIMESTAMP);
+	set.marked[set.marked_count] = section;
+	set.marked_count += 1;
+}
+
+void GpuTimers::end_frame() {
+	if (!enabled || !recording) return;
+	QuerySet &set = sets[current];
+	glQueryCounter(set.queries[set.marked_count], GL_TIMESTAMP);
+	set.marked[set.marked_count] = SectionCount;
+	set.pending = true;
+	recording = false;
+	current = (current + 1) % Frames;
+
+	GL_ERRORS();
+}
+
+void GpuTimers::collect() {
+	//sets finish in the order they were issued, so check from the oldest
+	// (sets[current], which end_frame moved on to, is the next to be reused and so the oldest):
+	for (uint32_t i = 0; i < Frames; ++i) {
+		QuerySet &set = sets[(current + i) % Frames];
+		if (!set.pending) continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(set.queries[set.marked_count], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+
+		GLuint64 stamps[SectionCount + 1];
+		for (uint32_t m = 0; m <= set.marked_count; ++m) {
+			glGetQueryObjectui64v(set.queries[m], GL_QUERY_RESULT, &stamps[m]);
+		}
+
+		for (uint32_t s = 0; s < SectionCount; ++s) {
+			times[s][next_sample] = 0.0f;
+		}
+		for (uint32_t m = 0; m < set.marked_count; ++m) {
+			times[set.marked[m]][next_sample] += float(double(stamps[m+1] - stamps[m]) * 1e-6);
+		}
+		times[SectionCount][next_sample] = float(double(stamps[set.marked_count] - stamps[0]) * 1e-6);
+
+		next_sample = (next_sample + 1) % Window;
+		sample_count = std::min< uint32_t >(sample_count + 1, Window);
+		set.pending = false;
+	}
+}
+
+GpuTimers::Stats GpuTimers::compute(uint32_t slot) const {
+	Stats ret;
+	if (sample_count == 0) return ret;
+	float sorted[Window];
+	std::copy(times[slot], times[slot] + sample_count, sorted);
+	std::sort(sorted, sorted + sample_count);
+	ret.min = sorted[0];
+	float sum = 0.0f;
+	for (uint32_t i = 0; i < sample_count; ++i) sum += sorted[i];
+	ret.avg = sum / float(sample_count);
+	ret.p99 = sorted[std::min(sample_count - 1, (sample_count * 99 + 99) / 100 - 1)];
+	return ret;
+}
+
+GpuTimers::Stats GpuTimers::stats(Section section) const {
+	assert(section < SectionCount);
+	return compute(section);
+}
+
+GpuTimers::Stats GpuTimers::frame_stats() const {
+	return compute(SectionCount);
+}
+
+void GpuTimers::report(std::ostream &to) const {
+	to << "GPU time (min/avg/p99 ms over " << sample_count << " frames):";
+	for (uint32_t s = 0; s < SectionCount; ++s) {
+		Stats st = stats(Section(s));
+		to << " " << section_name(Section(s)) << " " << st.min << "/" << st.avg << "/" << st.p99 << ";";
+	}
+	Stats st = frame_stats();
+	to << " frame " << st.min << "/" << st.avg << "/" << st.p99 << std::endl;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <iostream>
+#include <cstdint>
+
+//GpuTimers measures how long the GPU spends on each section of a frame, without stalling:
+// a GL_TIMESTAMP query is placed where each section starts (and one at the end of the frame),
+// and results are only read back once the GPU reports them available, a few frames later.
+//A section lasts until the next marked section starts, so sections should be marked in order;
+// sections that aren't marked in a frame count as taking no time.
+//
+//Usage (every frame):
+//  timers.begin_frame(); //collects finished frames' results, then marks Clear
+//  ... timers.mark(GpuTimers::Background); ... timers.mark(GpuTimers::HUD); ...
+//  timers.end_frame();
+//
+//Statistics cover the last 'Window' timed frames.
+//Nothing is done (and no queries are created) unless 'enabled' is set.
+
+struct GpuTimers {
+	GpuTimers() = default;
+	~GpuTimers();
+
+	GpuTimers(GpuTimers const &) = delete;
+	GpuTimers &operator=(GpuTimers const &) = delete;
+
+	enum Section : uint8_t {
+		Clear,
+		Background,
+		Objects,
+		HUD,
+		SectionCount
+	};
+	static char const *section_name(Section section);
+
+	bool enabled = false;
+
+	void begin_frame();
+	void mark(Section section);
+	void end_frame();
+
+	//rolling statistics for a section, in milliseconds:
+	struct Stats {
+		float min = 0.0f;
+		float avg = 0.0f;
+		float p99 = 0.0f;
+	};
+	Stats stats(Section section) const;
+	//GPU time for the whole frame (from begin_frame to end_frame):
+	Stats frame_stats() const;
+	uint32_t samples() const { return sample_count; }
+
+	//one line per section, plus the frame total:
+	void report(std::ostream &to) const;
+
+	//------- internals -------
+	enum : uint32_t {
+		Frames = 4, //sets of queries in flight (results are read this many frames late, at most)
+		Window = 128, //frames of statistics kept
+	};
+
+	struct QuerySet {
+		GLuint queries[SectionCount + 1]; //start of each section, then end of frame
+		uint8_t marked[SectionCount + 1]; //order in which sections were marked this frame (last: end of frame)
+		uint32_t marked_count = 0;
+		bool pending = false; //waiting on results
+	};
+	QuerySet sets[Frames];
+	uint32_t current = 0; //set being recorded (if recording)
+	bool recording = false;
+	bool created = false;
+
+	//(the extra section slot holds whole-frame times)
+	float times[SectionCount + 1][Window];
+	uint32_t next_sample = 0;
+	uint32_t sample_count = 0;
+
+	void collect(); //read back any finished sets
+	Stats compute(uint32_t slot) const;
+};
@@ -0,0 +1,145 @@
+#include "MappedBlob.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedBlob::MappedBlob(std::string const &filename) {
+	#if defined(_WIN32)
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size != 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping) {
+			bytes = reinterpret_cast< uint8_t const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (!bytes) {
+			if (mapping) CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map '" + filename + "'.");
+		}
+	}
+	#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(st.st_size);
+	if (size != 0) {
+		void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map '" + filename + "'.");
+		}
+		bytes = reinterpret_cast< uint8_t const * >(mapped);
+	}
+	//the mapping keeps its own reference to the file:
+	close(fd);
+	#endif
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	//if there is a table of contents, the chunk list comes from it:
+	if (size >= sizeof(ChunkHeader) && std::memcmp(bytes, "toc1", 4) == 0) {
+		ChunkHeader header;
+		std::memcpy(&header, bytes, sizeof(header));
+		if (header.size % sizeof(TocEntry) != 0 || size - sizeof(header) < header.size) {
+			unmap();
+			throw std::runtime_error("Malformed table of contents in '" + filename + "'.");
+		}
+		size_t end = sizeof(header) + header.size; //(end of the previous chunk)
+		for (size_t i = 0; i < header.size / sizeof(TocEntry); ++i) {
+			TocEntry entry;
+			std::memcpy(&entry, bytes + sizeof(header) + i * sizeof(TocEntry), sizeof(entry));
+			//chunks must follow one another (each after its header) and lie within the file:
+			if (entry.offset < end + sizeof(ChunkHeader) || entry.offset > size || size - entry.offset < entry.size) {
+				unmap();
+				throw std::runtime_error("Table of contents of '" + filename + "' lists a chunk outside the file.");
+			}
+			Chunk chunk;
+			std::memcpy(chunk.magic, entry.magic, 4);
+			chunk.offset = entry.offset;
+			chunk.size = entry.size;
+			chunks.emplace_back(chunk);
+			end = size_t(entry.offset) + entry.size;
+		}
+		has_toc = true;
+		return;
+	}
+
+	#if !defined(_WIN32)
+	//without a table, chunks get walked front-to-back (and handed to the driver) right away, so start paging in:
+	if (bytes) madvise(const_cast< uint8_t * >(bytes), size, MADV_WILLNEED);
+	#endif
+
+	//walk the chunk headers (but not the data) to build the chunk list:
+	size_t at = 0;
+	while (at < size) {
+		if (size - at < sizeof(ChunkHeader)) {
+			unmap();
+			throw std::runtime_error("Truncated chunk header in '" + filename + "'.");
+		}
+		ChunkHeader header;
+		std::memcpy(&header, bytes + at, sizeof(header));
+		at += sizeof(header);
+		if (size - at < header.size) {
+			unmap();
+			throw std::runtime_error("Truncated chunk data in '" + filename + "'.");
+		}
+		Chunk chunk;
+		std::memcpy(chunk.magic, header.magic, 4);
+		chunk.offset = at;
+		chunk.size = header.size;
+		//(tables of contents this code doesn't understand are skipped)
+		if (std::memcmp(header.magic, "toc", 3) != 0) chunks.emplace_back(chunk);
+		at += header.size;
+	}
+}
+
+MappedBlob::~MappedBlob() {
+	unmap();
+}
+
+void MappedBlob::unmap() {
+	#if defined(_WIN32)
+	if (bytes) UnmapViewOfFile(bytes);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+	#else
+	if (bytes) munmap(const_cast< uint8_t * >(bytes), size);
+	#endif
+	bytes = nullptr;
+	size = 0;
+}
+
+MappedBlob::Chunk const *MappedBlob::lookup(std::string const &magic) const {
+	for (auto const &chunk : chunks) {
+		if (std::string(chunk.magic, 4) == magic) return &chunk;
+	}
+	return nullptr;
+}
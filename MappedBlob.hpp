@@ -0,0 +1,127 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+//MappedBlob maps a chunked data file (e.g., "meshes.blob") read-only into memory
+// and hands out views of its chunks that point straight into the mapping.
+//It understands the same layout as read_chunk() -- a sequence of
+// (4-byte magic, uint32 size, size bytes of data) chunks -- but never copies:
+//
+//   MappedBlob blob(data_path("meshes.blob"));
+//   MappedBlob::ChunkView< Vertex > vertices = blob.read_chunk< Vertex >("dat0");
+//   glBufferData(GL_ARRAY_BUFFER, vertices.bytes(), vertices.data(), GL_STATIC_DRAW);
+//
+//Views are only valid as long as the MappedBlob they came from is alive.
+//
+//Blobs may begin with a table of contents: a "toc1" chunk of TocEntry records (see write_toc()), one
+// per chunk after it. MappedBlob then finds chunks from the table instead of walking every header, and
+// doesn't ask for the whole file to be paged in, since it will probably be read piecemeal (e.g., one
+// mesh at a time; see Game::load_mesh). The table itself isn't listed in 'chunks', so read_chunk()
+// sees the same sequence either way. Tables of other versions ("toc2", ...) are skipped.
+
+struct MappedBlob {
+	//maps 'filename'; throws if the file can't be opened or its chunk headers are malformed:
+	MappedBlob(std::string const &filename);
+	~MappedBlob();
+
+	MappedBlob(MappedBlob const &) = delete;
+	MappedBlob &operator=(MappedBlob const &) = delete;
+
+	//A typed window onto a chunk's data.
+	//Chunks are not padded, so elements may be misaligned; operator[] copies
+	// single elements out, while data()/bytes() expose the raw range for bulk use.
+	template< typename T >
+	struct ChunkView {
+		static_assert(std::is_trivially_copyable< T >::value, "chunk elements are raw bytes");
+
+		uint8_t const *begin = nullptr;
+		size_t count = 0;
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		void const *data() const { return begin; }
+		size_t bytes() const { return count * sizeof(T); }
+		T operator[](size_t i) const {
+			T ret;
+			std::memcpy(&ret, begin + i * sizeof(T), sizeof(T));
+			return ret;
+		}
+	};
+
+	//Location of each chunk in the file, in file order:
+	struct Chunk {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		size_t offset = 0; //offset of chunk data (just past the header)
+		size_t size = 0; //size of chunk data in bytes
+	};
+	std::vector< Chunk > chunks;
+
+	//"toc1" records:
+	struct TocEntry {
+		char magic[4];
+		uint32_t offset; //of the chunk's data, from the start of the file
+		uint32_t size; //of the chunk's data, in bytes
+	};
+	static_assert(sizeof(TocEntry) == 12, "TocEntry should be packed.");
+	bool has_toc = false; //(chunks came from a "toc1" table)
+
+	//read_chunk returns the next chunk in file order, throwing (like read_chunk())
+	// if its magic doesn't match or its size isn't a multiple of sizeof(T):
+	template< typename T >
+	ChunkView< T > read_chunk(std::string const &magic) {
+		if (next_chunk >= chunks.size()) {
+			throw std::runtime_error("Failed to read chunk header");
+		}
+		Chunk const &chunk = chunks[next_chunk];
+		if (std::string(chunk.magic, 4) != magic) {
+			throw std::runtime_error("Unexpected magic number in chunk");
+		}
+		++next_chunk;
+		return view< T >(chunk);
+	}
+
+	//has_chunk/find_chunk look up the first chunk with a given magic anywhere in the file;
+	// find_chunk throws if there is no such chunk:
+	bool has_chunk(std::string const &magic) const {
+		return lookup(magic) != nullptr;
+	}
+	template< typename T >
+	ChunkView< T > find_chunk(std::string const &magic) const {
+		Chunk const *chunk = lookup(magic);
+		if (!chunk) {
+			throw std::runtime_error("Missing '" + magic + "' chunk");
+		}
+		return view< T >(*chunk);
+	}
+
+	//true if read_chunk() has consumed every chunk:
+	bool at_end() const { return next_chunk == chunks.size(); }
+
+	//------- internals -------
+	template< typename T >
+	ChunkView< T > view(Chunk const &chunk) const {
+		if (chunk.size % sizeof(T) != 0) {
+			throw std::runtime_error("Size of chunk not divisible by element size");
+		}
+		ChunkView< T > ret;
+		ret.begin = bytes + chunk.offset;
+		ret.count = chunk.size / sizeof(T);
+		return ret;
+	}
+	Chunk const *lookup(std::string const &magic) const;
+	void unmap();
+
+	uint8_t const *bytes = nullptr; //start of mapping
+	size_t size = 0; //size of mapping
+	size_t next_chunk = 0; //read_chunk() cursor (index into chunks)
+
+	#if defined(_WIN32)
+	void *file = nullptr; //HANDLE from CreateFile
+	void *mapping = nullptr; //HANDLE from CreateFileMapping
+	#endif
+};
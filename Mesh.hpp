@@ -0,0 +1,33 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+//The location of a mesh in a (shared) vertex buffer:
+struct Mesh {
+	GLint first = 0;
+	GLsizei count = 0;
+	//for indexed meshes, the mesh's triangles are index_count indices starting at
+	// index_first in the element buffer; indices are relative to 'first':
+	GLuint index_first = 0;
+	GLsizei index_count = 0;
+	//for quantized meshes, object-space position = position_offset + position_scale * stored position:
+	glm::vec3 position_scale = glm::vec3(1.0f);
+	glm::vec3 position_offset = glm::vec3(0.0f);
+	//object-space bounding box:
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+
+	//coarser versions of an indexed mesh, from finest to coarsest; each draws the same vertices with
+	// fewer triangles (index_count indices starting at index_first) and is at most 'error' object-space
+	// units away from the full mesh (see MeshIndex::Lod):
+	enum : uint32_t { MaxLods = 3 };
+	struct Lod {
+		GLuint index_first = 0;
+		GLsizei index_count = 0;
+		float error = 0.0f;
+	};
+	Lod lods[MaxLods];
+	uint32_t lod_count = 0;
+};
@@ -0,0 +1,108 @@
+#include "MeshIndex.hpp"
+
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+
+//copy element 'i' out of a (possibly misaligned) array:
+template< typename T >
+static T element(void const *array, size_t i) {
+	T ret;
+	std::memcpy(&ret, static_cast< uint8_t const * >(array) + i * sizeof(T), sizeof(T));
+	return ret;
+}
+
+void MeshIndex::build(
+	char const *names, size_t name_count,
+	void const *entries, size_t entry_count,
+	size_t vertex_count,
+	void const *ranges, void const *indices, size_t index_count,
+	void const *quantizations,
+	void const *lods, size_t lod_count) {
+
+	std::vector< Mesh * > built(entry_count); //(for attaching lods)
+	for (size_t i = 0; i < entry_count; ++i) {
+		Entry const e = element< Entry >(entries, i);
+		if (e.name_begin > e.name_end || e.name_end > name_count) {
+			throw std::runtime_error("invalid name indices in index.");
+		}
+		if (e.vertex_begin > e.vertex_end || e.vertex_end > vertex_count) {
+			throw std::runtime_error("invalid vertex indices in index.");
+		}
+		Mesh mesh;
+		mesh.first = e.vertex_begin;
+		mesh.count = e.vertex_end - e.vertex_begin;
+		if (ranges) {
+			IndexRange const r = element< IndexRange >(ranges, i);
+			if (r.index_begin > r.index_end || r.index_end > index_count) {
+				throw std::runtime_error("invalid index range in index.");
+			}
+			mesh.index_first = r.index_begin;
+			mesh.index_count = r.index_end - r.index_begin;
+		}
+		if (quantizations) {
+			Quantization const q = element< Quantization >(quantizations, i);
+			mesh.position_scale = q.scale;
+			mesh.position_offset = q.offset;
+			//(stored positions span [-32767,32767] on each axis)
+			mesh.min = q.offset - 32767.0f * q.scale;
+			mesh.max = q.offset + 32767.0f * q.scale;
+		}
+		auto ret = meshes.insert(std::make_pair(
+					std::string(names + e.name_begin, names + e.name_end),
+					mesh));
+		if (!ret.second) {
+			throw std::runtime_error("duplicate name in index.");
+		}
+		built[i] = &ret.first->second;
+	}
+
+	for (size_t i = 0; i < lod_count; ++i) {
+		Lod const l = element< Lod >(lods, i);
+		if (!ranges || l.entry >= entry_count) {
+			throw std::runtime_error("level of detail for a missing mesh.");
+		}
+		if (i > 0 && element< Lod >(lods, i - 1).entry > l.entry) {
+			throw std::runtime_error("levels of detail out of order.");
+		}
+		Mesh &mesh = *built[l.entry];
+		if (mesh.lod_count == Mesh::MaxLods) {
+			throw std::runtime_error("too many levels of detail for one mesh.");
+		}
+		if (l.index_begin > l.index_end || l.index_end > index_count || (l.index_end - l.index_begin) % 3 != 0) {
+			throw std::runtime_error("invalid index range for level of detail.");
+		}
+		Mesh::Lod &lod = mesh.lods[mesh.lod_count++];
+		lod.index_first = l.index_begin;
+		lod.index_count = l.index_end - l.index_begin;
+		lod.error = l.error;
+	}
+
+	if (indices) {
+		for (Mesh const *mesh : built) {
+			check_indices(*mesh, indices);
+		}
+	}
+}
+
+void MeshIndex::check_indices(Mesh const &mesh, void const *indices) {
+	auto check = [&](GLuint first, GLsizei count) {
+		for (GLuint j = first; j < first + GLuint(count); ++j) {
+			if (element< uint16_t >(indices, j) >= uint32_t(mesh.count)) {
+				throw std::runtime_error("triangle index out of range for its mesh.");
+			}
+		}
+	};
+	check(mesh.index_first, mesh.index_count);
+	for (uint32_t l = 0; l < mesh.lod_count; ++l) {
+		check(mesh.lods[l].index_first, mesh.lods[l].index_count);
+	}
+}
+
+Mesh const &MeshIndex::lookup(std::string const &name) const {
+	auto f = meshes.find(name);
+	if (f == meshes.end()) {
+		throw std::runtime_error("Mesh named '" + name + "' does not appear in index.");
+	}
+	return f->second;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+//MeshIndex finds meshes by name. It is built from the index chunks of meshes.blob
+// (see Game::Game for the blob's layout); building it doesn't touch OpenGL.
+
+struct MeshIndex {
+	//records as stored in the blob:
+	struct Vertex { //"dat0" or "vtx0"
+		glm::vec3 Position;
+		glm::vec3 Normal;
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
+
+	//Quantized vertices: positions are int16 (dequantized with a per-mesh scale and offset),
+	// normals are octahedral-encoded into two int8s:
+	struct PackedVertex { //"dat1"
+		int16_t Position[3];
+		int8_t Normal[2];
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(PackedVertex) == 12, "PackedVertex should be packed.");
+
+	struct Entry { //"idx0"
+		uint32_t name_begin;
+		uint32_t name_end;
+		uint32_t vertex_begin;
+		uint32_t vertex_end;
+	};
+	static_assert(sizeof(Entry) == 16, "Entry should be packed.");
+
+	struct IndexRange { //"ixr0", one per entry (indexed blobs only)
+		uint32_t index_begin;
+		uint32_t index_end;
+	};
+	static_assert(sizeof(IndexRange) == 8, "IndexRange should be packed.");
+
+	struct Quantization { //"qnt0", one per entry (quantized blobs only)
+		glm::vec3 scale;
+		glm::vec3 offset;
+	};
+	static_assert(sizeof(Quantization) == 24, "Quantization should be packed.");
+
+	//Levels of detail: extra index ranges (into "ix16") that draw an entry's vertices with fewer triangles,
+	// each at most 'error' object-space units from the full mesh:
+	struct Lod { //"lod0", sorted by entry, then from finest to coarsest (indexed blobs only; optional)
+		uint32_t entry; //index of the entry in "idx0"
+		uint32_t index_begin;
+		uint32_t index_end;
+		float error;
+	};
+	static_assert(sizeof(Lod) == 16, "Lod should be packed.");
+
+	//add a mesh for each of 'entry_count' entries, checking every range against the data it refers to;
+	// 'ranges' (with 'indices'), 'quantizations', and 'lods' may be null for blobs that don't have them.
+	//Arrays are raw chunk data (Entry, IndexRange, uint16_t, Quantization, and Lod records), which may be misaligned.
+	//Quantized meshes get bounds from their quantization; others are left for the caller to fill in.
+	//Throws on out-of-range or duplicate entries.
+	//If 'indices' is null (but 'ranges' isn't), index ranges are still checked against 'index_count', but
+	// the indices themselves aren't read; check each mesh with check_indices() before drawing it.
+	void build(
+		char const *names, size_t name_count,
+		void const *entries, size_t entry_count,
+		size_t vertex_count,
+		void const *ranges, void const *indices, size_t index_count,
+		void const *quantizations,
+		void const *lods = nullptr, size_t lod_count = 0);
+
+	//throws if any of the mesh's indices (including those of its levels of detail) are past its vertices:
+	static void check_indices(Mesh const &mesh, void const *indices);
+
+	//throws if there is no mesh named 'name':
+	Mesh const &lookup(std::string const &name) const;
+
+	std::map< std::string, Mesh > meshes;
+};
@@ -0,0 +1,133 @@
+#include "MeshLoader.hpp"
+
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+MeshLoader::MeshLoader(std::string const &filename, std::vector< std::string > const &names_) : names(names_), meshes(names_.size()) {
+	blob.reset(new MappedBlob(filename));
+
+	//The blob may start with a table of contents ("toc1"; MappedBlob reads it), then will be made up of three chunks:
+	// the first chunk will be vertex data (interleaved position/normal/color)
+	// the second chunk will be characters
+	// the third chunk will be an index, mapping a name (range of characters) to a mesh (range of vertex data)
+	//Indexed blobs store deduplicated vertex data ("vtx0" instead of "dat0") and add two more chunks:
+	// the fourth chunk will be 16-bit triangle indices, relative to the first vertex of their mesh
+	// the fifth chunk will give the range of indices used by each mesh (in the same order as the index)
+	//Quantized blobs store PackedVertex data ("dat1") and add one more chunk:
+	// the next chunk will give the position scale and offset of each mesh (in the same order as the index)
+	//Indexed blobs may end with levels of detail ("lod0"; see MeshIndex::Lod), whose indices are also in the fourth chunk.
+	//Finding the chunks only reads their headers (or the table of contents), so it happens here; the data is left for the loader thread.
+	quantized = blob->has_chunk("dat1");
+	indexed = blob->has_chunk("ix16");
+
+	vertex_size = (quantized ? sizeof(MeshIndex::PackedVertex) : sizeof(MeshIndex::Vertex));
+	vertices = blob->read_chunk< uint8_t >(quantized ? "dat1" : (indexed ? "vtx0" : "dat0"));
+	if (vertices.size() % vertex_size != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	chunk_names = blob->read_chunk< char >("str0");
+	entries = blob->read_chunk< MeshIndex::Entry >("idx0");
+	if (indexed) {
+		indices = blob->read_chunk< uint16_t >("ix16");
+		ranges = blob->read_chunk< MeshIndex::IndexRange >("ixr0");
+		if (ranges.size() != entries.size()) {
+			throw std::runtime_error("index range count doesn't match index.");
+		}
+	}
+	if (quantized) {
+		quantizations = blob->read_chunk< MeshIndex::Quantization >("qnt0");
+		if (quantizations.size() != entries.size()) {
+			throw std::runtime_error("quantization count doesn't match index.");
+		}
+	}
+	if (indexed && blob->has_chunk("lod0")) {
+		lods = blob->read_chunk< MeshIndex::Lod >("lod0");
+	}
+	if (!blob->at_end()) {
+		std::cerr << "WARNING: trailing data in meshes file." << std::endl;
+	}
+
+	thread = std::thread(&MeshLoader::load, this);
+}
+
+MeshLoader::~MeshLoader() {
+	if (thread.joinable()) thread.join();
+}
+
+uint32_t MeshLoader::ready() const {
+	if (failed.load(std::memory_order_acquire)) {
+		throw std::runtime_error(error);
+	}
+	return published.load(std::memory_order_acquire);
+}
+
+Mesh const &MeshLoader::prepare(std::string const &name) {
+	index.lookup(name); //(throws if there is no such mesh)
+	Mesh &mesh = index.meshes.find(name)->second;
+
+	MeshIndex::check_indices(mesh, indices.data());
+
+	if (!quantized && mesh.count > 0) {
+		//bounds of unquantized meshes come from their vertices:
+		MappedBlob::ChunkView< MeshIndex::Vertex > positions;
+		positions.begin = vertices.begin;
+		positions.count = vertices.size() / sizeof(MeshIndex::Vertex);
+		mesh.min = mesh.max = positions[mesh.first].Position;
+		for (GLint v = mesh.first + 1; v < mesh.first + mesh.count; ++v) {
+			glm::vec3 p = positions[v].Position;
+			mesh.min = glm::min(mesh.min, p);
+			mesh.max = glm::max(mesh.max, p);
+		}
+	}
+	return mesh;
+}
+
+void MeshLoader::load() {
+	Profiler::set_thread_name("loader");
+	PROFILE_SCOPE("MeshLoader::load");
+	auto before = std::chrono::high_resolution_clock::now();
+	try {
+		//(indices are checked per mesh, by prepare(), so meshes that aren't used are never read)
+		index.build(
+			static_cast< char const * >(chunk_names.data()), chunk_names.size(),
+			entries.data(), entries.size(),
+			vertices.size() / vertex_size,
+			ranges.data(), nullptr, indices.size(),
+			quantizations.data(),
+			lods.data(), lods.size());
+
+		for (uint32_t i = 0; i < names.size(); ++i) {
+			Mesh const &mesh = prepare(names[i]);
+
+			//touch every page of the mesh's data, so uploading it won't wait on the disk:
+			// (MappedBlob doesn't ask for blobs with a table of contents to be paged in)
+			uint8_t sum = 0;
+			auto touch = [&sum](uint8_t const *begin, size_t bytes) {
+				for (size_t at = 0; at < bytes; at += 4096) sum += begin[at];
+			};
+			touch(vertices.begin + size_t(mesh.first) * vertex_size, size_t(mesh.count) * vertex_size);
+			if (!indices.empty()) {
+				touch(indices.begin + size_t(mesh.index_first) * sizeof(uint16_t), size_t(mesh.index_count) * sizeof(uint16_t));
+				for (uint32_t l = 0; l < mesh.lod_count; ++l) {
+					touch(indices.begin + size_t(mesh.lods[l].index_first) * sizeof(uint16_t), size_t(mesh.lods[l].index_count) * sizeof(uint16_t));
+				}
+			}
+			volatile uint8_t keep = sum; (void)keep; //(so the reads aren't optimized away)
+
+			meshes[i] = mesh;
+			if (i + 1 == names.size()) {
+				load_ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+			}
+			published.store(i + 1, std::memory_order_release);
+		}
+		if (names.empty()) {
+			load_ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+		}
+	} catch (std::exception &e) {
+		error = std::string("Failed to load meshes: ") + e.what();
+		failed.store(true, std::memory_order_release);
+	}
+}
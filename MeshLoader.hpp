@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "MeshIndex.hpp"
+#include "MappedBlob.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//MeshLoader reads meshes.blob on a background thread, so the main thread can show a window
+// (and compile shaders) in the meantime. It doesn't use OpenGL; the main thread uploads
+// each mesh as it becomes ready (see Game::poll_meshes):
+//
+//   MeshLoader loader(data_path("meshes.blob"), {"Doll", "Egg"});
+//   //...each frame:
+//   for (; uploaded < loader.ready(); ++uploaded) {
+//     Mesh const &mesh = loader.meshes[uploaded]; //is names[uploaded]
+//     glBufferSubData(..., loader.vertices.begin + mesh.first * loader.vertex_size);
+//   }
+//
+//The constructor maps the blob and finds its chunks (cheap, especially with a table of contents);
+// the loader thread then builds the index, checks each of 'names' in order, and pages in its data
+// before handing it over. Other meshes can be prepare()'d once everything named is ready.
+
+struct MeshLoader {
+	//starts loading 'names' from 'filename'; throws if the file can't be mapped or its chunks are wrong:
+	MeshLoader(std::string const &filename, std::vector< std::string > const &names);
+	~MeshLoader(); //(waits for the loader thread)
+
+	MeshLoader(MeshLoader const &) = delete;
+	MeshLoader &operator=(MeshLoader const &) = delete;
+
+	//how many of 'names' (from the start) are ready in 'meshes'; throws if loading failed:
+	uint32_t ready() const;
+	bool done() const { return ready() == names.size(); }
+
+	//check (and, for unquantized blobs, compute the bounds of) the mesh named 'name'; throws if it is missing or malformed:
+	// (the loader thread does this for each of 'names'; once done(), anyone may call it for other meshes)
+	Mesh const &prepare(std::string const &name);
+
+	//known after construction:
+	bool quantized = false; //vertices are MeshIndex::PackedVertex (otherwise MeshIndex::Vertex)
+	bool indexed = false; //meshes are drawn with 'indices'
+	size_t vertex_size = 0; //bytes per vertex
+	MappedBlob::ChunkView< uint8_t > vertices; //vertex chunk ("dat0", "vtx0", or "dat1")
+	MappedBlob::ChunkView< uint16_t > indices; //"ix16" (empty if the blob isn't indexed)
+
+	std::vector< std::string > names; //meshes to load
+	std::vector< Mesh > meshes; //meshes[i] is names[i] (valid once i < ready())
+	MeshIndex index; //every mesh in the blob (only use once done())
+
+	//how long the loader thread took (valid once done()):
+	double load_ms = 0.0;
+
+	//------- internals -------
+	void load(); //(runs on 'thread')
+
+	std::unique_ptr< MappedBlob > blob;
+	MappedBlob::ChunkView< char > chunk_names;
+	MappedBlob::ChunkView< MeshIndex::Entry > entries;
+	MappedBlob::ChunkView< MeshIndex::IndexRange > ranges;
+	MappedBlob::ChunkView< MeshIndex::Quantization > quantizations;
+	MappedBlob::ChunkView< MeshIndex::Lod > lods;
+
+	//the loader thread fills meshes[i] and then publishes it by storing i+1 (release), so the main
+	// thread never waits on a lock; on failure it sets 'error' and then 'failed':
+	std::atomic< uint32_t > published{0};
+	std::atomic< bool > failed{false};
+	std::string error;
+
+	std::thread thread;
+};
@@ -0,0 +1,544 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <queue>
+
+//------------ simulation ------------
+
+namespace {
+
+//a FIFO cache, tracked by when each vertex was last loaded (a vertex is cached if it was loaded
+// within the last 'size' loads); bumping 'time' by size+1 empties it:
+struct FIFOCache {
+	FIFOCache(uint32_t vertex_count, uint32_t size_) : size(size_), loaded(vertex_count, 0), time(size_ + 1) { }
+	uint32_t size;
+	std::vector< uint32_t > loaded;
+	uint32_t time;
+
+	void clear() { time += size + 1; }
+	//returns the number of misses (0-3) from drawing a triangle:
+	uint32_t triangle(uint16_t const *tri) {
+		uint32_t misses = 0;
+		for (uint32_t c = 0; c < 3; ++c) {
+			if (time - loaded[tri[c]] > size) {
+				loaded[tri[c]] = time++;
+				++misses;
+			}
+		}
+		return misses;
+	}
+};
+
+}
+
+CacheStats simulate_vertex_cache(std::vector< uint16_t > const &indices, uint32_t vertex_count, uint32_t cache_size) {
+	assert(indices.size() % 3 == 0);
+	CacheStats stats;
+	stats.triangles = uint32_t(indices.size() / 3);
+
+	FIFOCache cache(vertex_count, cache_size);
+	std::vector< bool > used(vertex_count, false);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		stats.misses += cache.triangle(&indices[i]);
+		for (uint32_t c = 0; c < 3; ++c) {
+			if (!used[indices[i+c]]) {
+				used[indices[i+c]] = true;
+				stats.vertices += 1;
+			}
+		}
+	}
+	return stats;
+}
+
+//------------ vertex cache ------------
+
+//Forsyth's scoring, tuned for a 32-entry LRU cache (the suggested values from the article):
+enum : uint32_t { ForsythCacheSize = 32 };
+static float const CacheDecayPower = 1.5f;
+static float const LastTriangleScore = 0.75f;
+static float const ValenceBoostScale = 2.0f;
+static float const ValenceBoostPower = 0.5f;
+
+//how much drawing a triangle that uses this vertex is worth:
+static float vertex_score(int32_t cache_position, uint32_t remaining_triangles) {
+	if (remaining_triangles == 0) return -1.0f; //(nothing left to draw)
+	float score = 0.0f;
+	if (cache_position >= 0) {
+		if (cache_position < 3) {
+			//used by the last triangle; a fixed score so strips don't win over fans:
+			score = LastTriangleScore;
+		} else {
+			float scale = 1.0f / float(ForsythCacheSize - 3);
+			score = std::pow(1.0f - float(cache_position - 3) * scale, CacheDecayPower);
+		}
+	}
+	//vertices with few triangles left get a boost, so they're finished off rather than stranded:
+	score += ValenceBoostScale * std::pow(float(remaining_triangles), -ValenceBoostPower);
+	return score;
+}
+
+void optimize_vertex_cache(std::vector< uint16_t > *_indices, uint32_t vertex_count) {
+	assert(_indices);
+	auto &indices = *_indices;
+	assert(indices.size() % 3 == 0);
+	uint32_t const triangle_count = uint32_t(indices.size() / 3);
+	if (triangle_count == 0) return;
+
+	//triangles using each vertex (vertex v's are vertex_triangles[first[v], first[v]+remaining[v])):
+	std::vector< uint32_t > first(vertex_count + 1, 0);
+	for (uint16_t i : indices) {
+		assert(i < vertex_count);
+		first[i + 1] += 1;
+	}
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		first[v + 1] += first[v];
+	}
+	std::vector< uint32_t > remaining(vertex_count, 0);
+	std::vector< uint32_t > vertex_triangles(indices.size());
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		for (uint32_t c = 0; c < 3; ++c) {
+			uint16_t v = indices[3*t+c];
+			vertex_triangles[first[v] + remaining[v]] = t;
+			remaining[v] += 1;
+		}
+	}
+
+	std::vector< int32_t > cache_position(vertex_count, -1);
+	std::vector< float > score(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		score[v] = vertex_score(-1, remaining[v]);
+	}
+	std::vector< float > triangle_score(triangle_count);
+	std::vector< bool > drawn(triangle_count, false);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		triangle_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+	}
+
+	std::vector< uint16_t > cache, next_cache;
+	cache.reserve(ForsythCacheSize + 3);
+	next_cache.reserve(ForsythCacheSize + 3);
+
+	std::vector< uint16_t > result;
+	result.reserve(indices.size());
+
+	uint32_t best = -1U;
+	uint32_t scan = 0; //(triangles before this have all been drawn)
+	while (result.size() < indices.size()) {
+		if (best == -1U) {
+			//nothing in the cache is worth drawing (e.g., at the start, or a patch was finished); take the best of the rest:
+			while (drawn[scan]) ++scan;
+			best = scan;
+			for (uint32_t t = scan + 1; t < triangle_count; ++t) {
+				if (!drawn[t] && triangle_score[t] > triangle_score[best]) best = t;
+			}
+		}
+
+		//draw it:
+		uint16_t const *tri = &indices[3 * best];
+		result.insert(result.end(), tri, tri + 3);
+		drawn[best] = true;
+		for (uint32_t c = 0; c < 3; ++c) {
+			uint16_t v = tri[c];
+			uint32_t *begin = &vertex_triangles[first[v]];
+			uint32_t *end = begin + remaining[v];
+			uint32_t *at = std::find(begin, end, best);
+			assert(at != end);
+			std::swap(*at, *(end - 1));
+			remaining[v] -= 1;
+		}
+
+		//its vertices go to the front of the cache:
+		next_cache.clear();
+		for (uint32_t c = 0; c < 3; ++c) {
+			if (std::find(next_cache.begin(), next_cache.end(), tri[c]) == next_cache.end()) next_cache.emplace_back(tri[c]);
+		}
+		size_t const front = next_cache.size(); //(the triangle's distinct vertices)
+		for (uint16_t v : cache) {
+			if (std::find(next_cache.begin(), next_cache.begin() + front, v) == next_cache.begin() + front) {
+				next_cache.emplace_back(v);
+			}
+		}
+		std::swap(cache, next_cache);
+
+		//rescore everything that was in the cache (and so everything whose score changed):
+		for (uint32_t i = 0; i < cache.size(); ++i) {
+			uint16_t v = cache[i];
+			cache_position[v] = (i < ForsythCacheSize ? int32_t(i) : -1);
+			score[v] = vertex_score(cache_position[v], remaining[v]);
+		}
+		//...and the triangles that use those vertices, choosing the next one to draw from them:
+		best = -1U;
+		float best_score = 0.0f;
+		for (uint16_t v : cache) {
+			for (uint32_t i = first[v]; i < first[v] + remaining[v]; ++i) {
+				uint32_t t = vertex_triangles[i];
+				triangle_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+				if (best == -1U || triangle_score[t] > best_score) {
+					best = t;
+					best_score = triangle_score[t];
+				}
+			}
+		}
+		if (cache.size() > ForsythCacheSize) cache.resize(ForsythCacheSize);
+	}
+
+	indices = result;
+}
+
+//------------ overdraw ------------
+
+void optimize_overdraw(std::vector< uint16_t > *_indices, std::vector< glm::vec3 > const &positions, float threshold) {
+	assert(_indices);
+	auto &indices = *_indices;
+	assert(indices.size() % 3 == 0);
+	uint32_t const triangle_count = uint32_t(indices.size() / 3);
+	if (triangle_count == 0) return;
+	uint32_t const vertex_count = uint32_t(positions.size());
+	FIFOCache cache(vertex_count, VertexCacheSize);
+
+	//patches start wherever the cache-optimized order starts over (a triangle that misses on every vertex):
+	std::vector< uint32_t > hard;
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		if (cache.triangle(&indices[3*t]) == 3 || t == 0) hard.emplace_back(t);
+	}
+	hard.emplace_back(triangle_count);
+
+	//...and are split further wherever the order so far is as cache-friendly as the whole patch (within 'threshold'):
+	std::vector< uint32_t > patches;
+	for (uint32_t h = 0; h + 1 < hard.size(); ++h) {
+		uint32_t begin = hard[h], end = hard[h+1];
+		cache.clear();
+		uint32_t misses = 0;
+		for (uint32_t t = begin; t < end; ++t) {
+			misses += cache.triangle(&indices[3*t]);
+		}
+		float patch_threshold = threshold * float(misses) / float(end - begin);
+
+		patches.emplace_back(begin);
+		cache.clear();
+		uint32_t running_misses = 0, running_triangles = 0;
+		for (uint32_t t = begin; t < end; ++t) {
+			running_misses += cache.triangle(&indices[3*t]);
+			running_triangles += 1;
+			if (float(running_misses) <= patch_threshold * float(running_triangles) && t + 1 < end) {
+				patches.emplace_back(t + 1);
+				cache.clear();
+				running_misses = running_triangles = 0;
+			}
+		}
+	}
+	patches.emplace_back(triangle_count);
+
+	//how much each patch faces away from the mesh's center (those that face out most are likely to occlude others):
+	glm::vec3 center = glm::vec3(0.0f);
+	for (uint16_t i : indices) {
+		center += positions[i];
+	}
+	center /= float(indices.size());
+
+	std::vector< float > facing(patches.size() - 1);
+	for (uint32_t p = 0; p + 1 < patches.size(); ++p) {
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f); //(area-weighted, so the sum of cross products)
+		float area = 0.0f;
+		for (uint32_t t = patches[p]; t < patches[p+1]; ++t) {
+			glm::vec3 const &a = positions[indices[3*t+0]];
+			glm::vec3 const &b = positions[indices[3*t+1]];
+			glm::vec3 const &c = positions[indices[3*t+2]];
+			glm::vec3 n = glm::cross(b - a, c - a);
+			float twice_area = glm::length(n);
+			centroid += (a + b + c) * (twice_area / 3.0f);
+			normal += n;
+			area += twice_area;
+		}
+		float length = glm::length(normal);
+		if (area > 0.0f) centroid /= area;
+		if (length > 0.0f) normal /= length;
+		facing[p] = glm::dot(centroid - center, normal);
+	}
+
+	std::vector< uint32_t > order(facing.size());
+	for (uint32_t p = 0; p < order.size(); ++p) {
+		order[p] = p;
+	}
+	std::stable_sort(order.begin(), order.end(), [&facing](uint32_t a, uint32_t b) {
+		return facing[a] > facing[b];
+	});
+
+	std::vector< uint16_t > result;
+	result.reserve(indices.size());
+	for (uint32_t p : order) {
+		result.insert(result.end(), indices.begin() + 3 * patches[p], indices.begin() + 3 * patches[p+1]);
+	}
+	indices = result;
+}
+
+//------------ vertex fetch ------------
+
+std::vector< uint32_t > optimize_vertex_fetch(std::vector< uint16_t > *_indices, uint32_t vertex_count) {
+	assert(_indices);
+	auto &indices = *_indices;
+	std::vector< uint32_t > remap(vertex_count, -1U);
+	uint32_t next = 0;
+	for (uint16_t &i : indices) {
+		assert(i < vertex_count);
+		if (remap[i] == -1U) remap[i] = next++;
+		i = uint16_t(remap[i]);
+	}
+	return remap;
+}
+
+//------------ simplification ------------
+
+namespace {
+
+//sum of squared distances to a set of planes, as a symmetric 4x4 matrix (Garland and Heckbert);
+// stored as its upper triangle: xx xy xz xw yy yz yw zz zw ww
+struct Quadric {
+	double q[10] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+	//add the plane through 'point' with unit normal 'normal':
+	void add_plane(glm::dvec3 const &normal, glm::dvec3 const &point) {
+		double p[4] = {normal.x, normal.y, normal.z, -glm::dot(normal, point)};
+		uint32_t k = 0;
+		for (uint32_t i = 0; i < 4; ++i) {
+			for (uint32_t j = i; j < 4; ++j) {
+				q[k++] += p[i] * p[j];
+			}
+		}
+	}
+	Quadric &operator+=(Quadric const &other) {
+		for (uint32_t k = 0; k < 10; ++k) q[k] += other.q[k];
+		return *this;
+	}
+	double error(glm::dvec3 const &p) const {
+		double e =
+			  q[0] * p.x * p.x + 2.0 * q[1] * p.x * p.y + 2.0 * q[2] * p.x * p.z + 2.0 * q[3] * p.x
+			+ q[4] * p.y * p.y + 2.0 * q[5] * p.y * p.z + 2.0 * q[6] * p.y
+			+ q[7] * p.z * p.z + 2.0 * q[8] * p.z
+			+ q[9];
+		return std::max(0.0, e); //(rounding can take it slightly negative)
+	}
+};
+
+//a possible collapse of position 'from' onto position 'to':
+struct Collapse {
+	double cost;
+	uint32_t from, to;
+	uint32_t from_version, to_version; //(stale if either position has changed since)
+	bool operator<(Collapse const &other) const { return cost > other.cost; } //(so std::priority_queue pops the cheapest)
+};
+
+}
+
+std::vector< uint16_t > simplify(
+	std::vector< uint16_t > const &indices,
+	std::vector< glm::vec3 > const &positions,
+	std::vector< glm::vec3 > const &normals,
+	std::vector< glm::u8vec4 > const &colors,
+	size_t target_index_count, float max_error, float *_error) {
+	assert(indices.size() % 3 == 0);
+	assert(normals.size() == positions.size() && colors.size() == positions.size());
+	uint32_t const vertex_count = uint32_t(positions.size());
+	uint32_t const triangle_count = uint32_t(indices.size() / 3);
+	if (_error) *_error = 0.0f;
+
+	//vertices that share a position (but not, e.g., a normal) move together, so weld them into one 'point':
+	std::vector< uint32_t > by_position(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		by_position[v] = v;
+	}
+	std::sort(by_position.begin(), by_position.end(), [&positions](uint32_t a, uint32_t b) {
+		glm::vec3 const &pa = positions[a], &pb = positions[b];
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	});
+	std::vector< uint32_t > point(vertex_count);
+	std::vector< glm::dvec3 > point_position;
+	std::vector< std::vector< uint16_t > > point_vertices;
+	for (uint32_t i = 0; i < vertex_count; ++i) {
+		uint32_t v = by_position[i];
+		if (i == 0 || positions[v] != positions[by_position[i-1]]) {
+			point_position.emplace_back(glm::dvec3(positions[v]));
+			point_vertices.emplace_back();
+		}
+		point[v] = uint32_t(point_position.size() - 1);
+		point_vertices.back().emplace_back(uint16_t(v));
+	}
+	uint32_t const point_count = uint32_t(point_position.size());
+
+	//triangles (as vertices) and the triangles around each point:
+	std::vector< uint16_t > corners = indices;
+	std::vector< bool > alive(triangle_count, true);
+	uint32_t alive_count = triangle_count;
+	std::vector< std::vector< uint32_t > > point_triangles(point_count);
+	auto triangle_point = [&](uint32_t t, uint32_t c) { return point[corners[3*t+c]]; };
+
+	//each point's quadric measures distance to the planes of the triangles around it:
+	std::vector< Quadric > quadrics(point_count);
+	std::map< std::pair< uint32_t, uint32_t >, uint32_t > edge_uses; //(directed edges between points, for finding borders)
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		uint32_t p[3] = {triangle_point(t, 0), triangle_point(t, 1), triangle_point(t, 2)};
+		if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0]) {
+			alive[t] = false; //(degenerate already)
+			alive_count -= 1;
+			continue;
+		}
+		glm::dvec3 n = glm::cross(point_position[p[1]] - point_position[p[0]], point_position[p[2]] - point_position[p[0]]);
+		double length = glm::length(n);
+		for (uint32_t c = 0; c < 3; ++c) {
+			point_triangles[p[c]].emplace_back(t);
+			if (length > 0.0) quadrics[p[c]].add_plane(n / length, point_position[p[0]]);
+			edge_uses[std::make_pair(std::min(p[c], p[(c+1)%3]), std::max(p[c], p[(c+1)%3]))] += 1;
+		}
+	}
+	//...and edges on the border of the mesh get a plane perpendicular to their triangle, so outlines are kept:
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		if (!alive[t]) continue;
+		uint32_t p[3] = {triangle_point(t, 0), triangle_point(t, 1), triangle_point(t, 2)};
+		glm::dvec3 n = glm::cross(point_position[p[1]] - point_position[p[0]], point_position[p[2]] - point_position[p[0]]);
+		for (uint32_t c = 0; c < 3; ++c) {
+			uint32_t a = p[c], b = p[(c+1)%3];
+			if (edge_uses[std::make_pair(std::min(a, b), std::max(a, b))] != 1) continue;
+			glm::dvec3 border = glm::cross(point_position[b] - point_position[a], n);
+			double length = glm::length(border);
+			if (length == 0.0) continue;
+			quadrics[a].add_plane(border / length, point_position[a]);
+			quadrics[b].add_plane(border / length, point_position[a]);
+		}
+	}
+
+	//points sharing a triangle with 'p':
+	std::vector< uint32_t > around, around_other;
+	auto neighbors = [&](uint32_t p, std::vector< uint32_t > *_out) {
+		auto &out = *_out;
+		out.clear();
+		for (uint32_t t : point_triangles[p]) {
+			if (!alive[t]) continue;
+			for (uint32_t c = 0; c < 3; ++c) {
+				uint32_t n = triangle_point(t, c);
+				if (n != p) out.emplace_back(n);
+			}
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	};
+
+	//the vertex at point 'to' that should stand in for vertex 'v' (same color, closest normal), or -1U if none:
+	auto substitute = [&](uint16_t v, uint32_t to) -> uint32_t {
+		uint32_t best = -1U;
+		float best_dot = 0.0f;
+		for (uint16_t w : point_vertices[to]) {
+			if (colors[w] != colors[v]) continue;
+			float d = glm::dot(normals[w], normals[v]);
+			if (best == -1U || d > best_dot) {
+				best = w;
+				best_dot = d;
+			}
+		}
+		return best;
+	};
+
+	std::vector< uint32_t > version(point_count, 0);
+	std::priority_queue< Collapse > queue;
+	auto consider = [&](uint32_t from, uint32_t to) {
+		Quadric q = quadrics[from];
+		q += quadrics[to];
+		Collapse collapse;
+		collapse.cost = q.error(point_position[to]);
+		collapse.from = from;
+		collapse.to = to;
+		collapse.from_version = version[from];
+		collapse.to_version = version[to];
+		queue.push(collapse);
+	};
+	for (uint32_t p = 0; p < point_count; ++p) {
+		neighbors(p, &around);
+		for (uint32_t n : around) consider(p, n);
+	}
+
+	//can 'from' move onto 'to' without folding the mesh over, pinching it, or changing colors?
+	auto allowed = [&](uint32_t from, uint32_t to) -> bool {
+		//the points both are next to must be exactly those of the triangles that will disappear:
+		neighbors(from, &around);
+		neighbors(to, &around_other);
+		uint32_t common = 0;
+		for (uint32_t n : around) {
+			if (std::binary_search(around_other.begin(), around_other.end(), n)) common += 1;
+		}
+		uint32_t shared = 0;
+		for (uint32_t t : point_triangles[from]) {
+			if (!alive[t]) continue;
+			bool has_to = (triangle_point(t, 0) == to || triangle_point(t, 1) == to || triangle_point(t, 2) == to);
+			if (has_to) {
+				shared += 1;
+				continue;
+			}
+			//the remaining triangles shouldn't flip (or turn much) and their corners need stand-ins:
+			glm::dvec3 before[3], after[3];
+			for (uint32_t c = 0; c < 3; ++c) {
+				uint32_t p = triangle_point(t, c);
+				before[c] = after[c] = point_position[p];
+				if (p == from) {
+					after[c] = point_position[to];
+					if (substitute(corners[3*t+c], to) == -1U) return false;
+				}
+			}
+			glm::dvec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::dvec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+			double l0 = glm::length(n0), l1 = glm::length(n1);
+			if (l1 == 0.0 || glm::dot(n0, n1) < 0.25 * l0 * l1) return false;
+		}
+		return shared > 0 && common == shared;
+	};
+
+	float error = 0.0f;
+	while (alive_count * 3 > target_index_count && !queue.empty()) {
+		Collapse collapse = queue.top();
+		queue.pop();
+		uint32_t from = collapse.from, to = collapse.to;
+		if (collapse.from_version != version[from] || collapse.to_version != version[to]) continue;
+		float collapse_error = float(std::sqrt(collapse.cost));
+		if (collapse_error > max_error) break;
+		if (!allowed(from, to)) continue;
+
+		//triangles along the edge disappear; the rest move their 'from' corners onto 'to':
+		for (uint32_t t : point_triangles[from]) {
+			if (!alive[t]) continue;
+			bool has_to = (triangle_point(t, 0) == to || triangle_point(t, 1) == to || triangle_point(t, 2) == to);
+			if (has_to) {
+				alive[t] = false;
+				alive_count -= 1;
+				continue;
+			}
+			for (uint32_t c = 0; c < 3; ++c) {
+				if (triangle_point(t, c) == from) corners[3*t+c] = uint16_t(substitute(corners[3*t+c], to));
+			}
+			point_triangles[to].emplace_back(t);
+		}
+		point_triangles[from].clear();
+		quadrics[to] += quadrics[from];
+		version[from] += 1;
+		version[to] += 1;
+		error = std::max(error, collapse_error);
+
+		neighbors(to, &around);
+		std::vector< uint32_t > next = around;
+		for (uint32_t n : next) {
+			consider(n, to);
+			consider(to, n);
+		}
+	}
+
+	std::vector< uint16_t > result;
+	result.reserve(alive_count * 3);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		if (alive[t]) result.insert(result.end(), &corners[3*t], &corners[3*t] + 3);
+	}
+	if (_error) *_error = error;
+	return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//MeshOptimizer reorders the triangles (and vertices) of an indexed mesh so it draws faster,
+// without changing what it draws. meshc runs it on every mesh it writes:
+//
+//   optimize_vertex_cache(&indices, vertex_count); //triangles that share vertices end up close together
+//   optimize_overdraw(&indices, positions); //outward-facing patches of triangles go first
+//   std::vector< uint32_t > remap = optimize_vertex_fetch(&indices, vertex_count); //vertices in order of use
+//
+//simulate_vertex_cache() measures the result (see CacheStats).
+//simplify() makes coarser versions of a mesh (levels of detail) that draw its vertices with fewer triangles.
+//Indices are 16-bit, as in meshes.blob, and refer to vertices [0,vertex_count).
+
+//How well an index order uses a FIFO post-transform vertex cache (roughly what GPUs have):
+struct CacheStats {
+	uint32_t triangles = 0;
+	uint32_t vertices = 0; //distinct vertices referenced
+	uint32_t misses = 0; //vertex shader invocations
+	//average cache miss ratio: misses per triangle (0.5 is ideal for large regular meshes, 3.0 is worst):
+	float acmr() const { return triangles ? float(misses) / float(triangles) : 0.0f; }
+	//average transform to vertex ratio: misses per vertex (1.0 is ideal):
+	float atvr() const { return vertices ? float(misses) / float(vertices) : 0.0f; }
+};
+
+//size of the FIFO cache that simulate_vertex_cache() and optimize_overdraw() model:
+enum : uint32_t { VertexCacheSize = 16 };
+
+CacheStats simulate_vertex_cache(std::vector< uint16_t > const &indices, uint32_t vertex_count, uint32_t cache_size = VertexCacheSize);
+
+//reorder triangles to reduce cache misses (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation");
+// each triangle keeps its winding:
+void optimize_vertex_cache(std::vector< uint16_t > *indices, uint32_t vertex_count);
+
+//reorder patches of triangles (as left by optimize_vertex_cache) so those facing away from the mesh's
+// center draw first and are more likely to hide the rest (after Sander, Nehab, and Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw");
+//patches are only split where that costs less than 'threshold' times the patch's cache miss ratio:
+void optimize_overdraw(std::vector< uint16_t > *indices, std::vector< glm::vec3 > const &positions, float threshold = 1.05f);
+
+//renumber vertices in the order the triangles first use them (dropping unused ones), so vertex fetches
+// walk memory forward; returns the new number of each old vertex (-1U if unused):
+std::vector< uint32_t > optimize_vertex_fetch(std::vector< uint16_t > *indices, uint32_t vertex_count);
+
+//collapse edges of the mesh, cheapest first by quadric error (Garland and Heckbert, "Surface Simplification
+// Using Quadric Error Metrics"), until at most 'target_index_count' indices remain or the next collapse would
+// move the surface by more than 'max_error'; returns the remaining triangles, which only use existing vertices:
+// - vertices at the same position move together (so flat-shaded meshes can be simplified);
+// - a corner that moves takes the vertex at its new position with the same color and the closest normal,
+//   and collapses that would change a corner's color are skipped, so color regions keep their outlines;
+// - '*error' (if not null) gets the largest distance (in the units of 'positions') any collapse moved the surface.
+std::vector< uint16_t > simplify(
+	std::vector< uint16_t > const &indices,
+	std::vector< glm::vec3 > const &positions,
+	std::vector< glm::vec3 > const &normals,
+	std::vector< glm::u8vec4 > const &colors,
+	size_t target_index_count, float max_error, float *error = nullptr);
@@ -0,0 +1,234 @@
+#include "Offscreen.hpp"
+
+#include "gl_errors.hpp"
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+#ifdef __linux__
+
+//is 'name' in the space-separated list 'extensions'?
+static bool has_extension(char const *extensions, char const *name) {
+	if (!extensions) return false;
+	size_t length = std::strlen(name);
+	for (char const *at = extensions; (at = std::strstr(at, name)); at += length) {
+		if ((at == extensions || at[-1] == ' ') && (at[length] == ' ' || at[length] == '\0')) return true;
+	}
+	return false;
+}
+
+Offscreen::Offscreen(glm::uvec2 size_) : size(size_) {
+	if (size.x == 0 || size.y == 0) {
+		throw std::runtime_error("Offscreen framebuffer size must be nonzero.");
+	}
+
+	//prefer a display that needs no window system at all:
+	char const *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+	if (has_extension(client_extensions, "EGL_MESA_platform_surfaceless") && has_extension(client_extensions, "EGL_EXT_platform_base")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC GetPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (GetPlatformDisplay) {
+			egl_display = GetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+	}
+	if (egl_display == EGL_NO_DISPLAY) {
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint major = 0, minor = 0;
+	if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor)) {
+		throw std::runtime_error("Failed to initialize an EGL display.");
+	}
+	display = egl_display;
+
+	try {
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			throw std::runtime_error("EGL display doesn't support desktop OpenGL.");
+		}
+		bool surfaceless = has_extension(eglQueryString(egl_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+		//(the framebuffer object is what gets drawn to, so the config only matters for the fallback pbuffer)
+		EGLint const config_attribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+			EGL_NONE
+		};
+		EGLConfig config = nullptr;
+		EGLint configs = 0;
+		if (!eglChooseConfig(egl_display, config_attribs, &config, 1, &configs) || configs == 0) {
+			throw std::runtime_error("No EGL config supports desktop OpenGL pbuffers.");
+		}
+
+		//same version and profile as the windowed context:
+		EGLint const context_attribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+			EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+			EGL_NONE
+		};
+		context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+		if (context == EGL_NO_CONTEXT) {
+			context = nullptr;
+			throw std::runtime_error("Failed to create an OpenGL 3.3 core context with EGL.");
+		}
+
+		if (!surfaceless) {
+			EGLint const pbuffer_attribs[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+			surface = eglCreatePbufferSurface(egl_display, config, pbuffer_attribs);
+			if (surface == EGL_NO_SURFACE) {
+				surface = nullptr;
+				throw std::runtime_error("Failed to create an EGL pbuffer.");
+			}
+		}
+		EGLSurface egl_surface = (surface ? EGLSurface(surface) : EGL_NO_SURFACE);
+		if (!eglMakeCurrent(egl_display, egl_surface, egl_surface, EGLContext(context))) {
+			throw std::runtime_error("Failed to make the EGL context current.");
+		}
+
+		//the framebuffer is laid out like a window's default framebuffer (RGBA8 color, 24-bit depth, 8-bit stencil):
+		glGenRenderbuffers(1, &color);
+		glBindRenderbuffer(GL_RENDERBUFFER, color);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+		glGenRenderbuffers(1, &depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("Offscreen framebuffer is incomplete.");
+		}
+
+		bind();
+		GL_ERRORS();
+	} catch (...) {
+		release();
+		throw;
+	}
+}
+
+Offscreen::~Offscreen() {
+	release();
+}
+
+void Offscreen::release() {
+	if (!display) return;
+
+	if (framebuffer != -1U) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		framebuffer = -1U;
+	}
+	if (color != -1U) {
+		glDeleteRenderbuffers(1, &color);
+		color = -1U;
+	}
+	if (depth != -1U) {
+		glDeleteRenderbuffers(1, &depth);
+		depth = -1U;
+	}
+
+	eglMakeCurrent(EGLDisplay(display), EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (surface) {
+		eglDestroySurface(EGLDisplay(display), EGLSurface(surface));
+		surface = nullptr;
+	}
+	if (context) {
+		eglDestroyContext(EGLDisplay(display), EGLContext(context));
+		context = nullptr;
+	}
+	eglTerminate(EGLDisplay(display));
+	display = nullptr;
+}
+
+void *Offscreen::get_proc_address(char const *name) {
+	return reinterpret_cast< void * >(eglGetProcAddress(name));
+}
+
+#else //no EGL
+
+Offscreen::Offscreen(glm::uvec2 size_) : size(size_) {
+	throw std::runtime_error("Offscreen rendering needs EGL, which is only supported on Linux.");
+}
+
+Offscreen::~Offscreen() {
+}
+
+void Offscreen::release() {
+}
+
+void *Offscreen::get_proc_address(char const *) {
+	return nullptr;
+}
+
+#endif
+
+void Offscreen::bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, size.x, size.y);
+}
+
+std::vector< glm::u8vec4 > Offscreen::read_pixels() const {
+	std::vector< glm::u8vec4 > pixels(size.x * size.y);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	GL_ERRORS();
+
+	//GL reads rows from the bottom up; flip them:
+	for (uint32_t y = 0; y < size.y / 2; ++y) {
+		std::swap_ranges(pixels.begin() + y * size.x, pixels.begin() + (y + 1) * size.x, pixels.begin() + (size.y - 1 - y) * size.x);
+	}
+	return pixels;
+}
+
+std::string Offscreen::description() const {
+	char const *version = reinterpret_cast< char const * >(glGetString(GL_VERSION));
+	char const *renderer = reinterpret_cast< char const * >(glGetString(GL_RENDERER));
+	return std::string(version ? version : "?") + " / " + (renderer ? renderer : "?");
+}
+
+void Offscreen::save_ppm(std::string const &filename, glm::uvec2 size, std::vector< glm::u8vec4 > const &pixels) {
+	if (pixels.size() != size_t(size.x) * size.y) {
+		throw std::runtime_error("Pixel count doesn't match image size.");
+	}
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "' to write an image.");
+	}
+	file << "P6\n" << size.x << " " << size.y << "\n255\n";
+	std::vector< char > row(size.x * 3);
+	for (uint32_t y = 0; y < size.y; ++y) {
+		for (uint32_t x = 0; x < size.x; ++x) {
+			glm::u8vec4 const &px = pixels[y * size.x + x];
+			row[3*x+0] = char(px.x);
+			row[3*x+1] = char(px.y);
+			row[3*x+2] = char(px.z);
+		}
+		file.write(row.data(), row.size());
+	}
+	if (!file) {
+		throw std::runtime_error("Failed to write image to '" + filename + "'.");
+	}
+}
+
+uint64_t Offscreen::hash(std::vector< glm::u8vec4 > const &pixels) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (glm::u8vec4 const &px : pixels) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			h = (h ^ px[c]) * 0x100000001b3ULL;
+		}
+	}
+	return h;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+//Offscreen renders without a window (or a display, or a GPU -- Mesa's llvmpipe works):
+// it makes an OpenGL 3.3 core context current through EGL, then draws into a framebuffer
+// object of a fixed size. Used by main's --offscreen mode.
+//
+//The context is surfaceless where EGL supports it (EGL_MESA_platform_surfaceless and
+// EGL_KHR_surfaceless_context), and otherwise renders alongside a tiny pbuffer.
+//EGL is only available on Linux; elsewhere the constructor throws.
+
+struct Offscreen {
+	//create a context and a 'size' framebuffer, leaving both current; throws on failure:
+	Offscreen(glm::uvec2 size);
+	~Offscreen();
+
+	Offscreen(Offscreen const &) = delete;
+	Offscreen &operator=(Offscreen const &) = delete;
+
+	glm::uvec2 size;
+
+	//bind the framebuffer and set the viewport to cover it:
+	void bind();
+
+	//the framebuffer's color, as RGBA rows from the top of the image down:
+	std::vector< glm::u8vec4 > read_pixels() const;
+
+	//the context's OpenGL version and renderer (e.g., "4.5 (Core Profile) Mesa 22.3.6 / llvmpipe"):
+	std::string description() const;
+
+	//look up an OpenGL function (e.g., for RingBuffer::get_proc_address):
+	static void *get_proc_address(char const *name);
+
+	//write pixels (as from read_pixels) to a binary PPM image; throws on failure:
+	static void save_ppm(std::string const &filename, glm::uvec2 size, std::vector< glm::u8vec4 > const &pixels);
+
+	//FNV-1a hash of pixels (as from read_pixels), for spotting changes in rendering:
+	static uint64_t hash(std::vector< glm::u8vec4 > const &pixels);
+
+	//------- internals -------
+	void *display = nullptr; //EGLDisplay
+	void *context = nullptr; //EGLContext
+	void *surface = nullptr; //EGLSurface (only if the context can't be surfaceless)
+
+	GLuint framebuffer = -1U;
+	GLuint color = -1U; //RGBA8 renderbuffer
+	GLuint depth = -1U; //depth24+stencil8 renderbuffer
+
+	void release(); //(free whatever has been created)
+};
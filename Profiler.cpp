@@ -0,0 +1,137 @@
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+struct Event {
+	char const *name;
+	uint64_t begin;
+	uint64_t end;
+};
+
+//One thread's events. Only the owning thread writes; 'head' counts events ever written,
+// so event k lives at events[k % Capacity] until it is overwritten by event k + Capacity.
+struct ThreadEvents {
+	enum : uint64_t { Capacity = 1 << 16 };
+	uint32_t tid = 0;
+	std::string name; //(guarded by registry().mutex)
+	std::atomic< uint64_t > head{0};
+	Event events[Capacity];
+};
+
+//every thread's events, kept until exit (so traces can include threads that have finished):
+struct Registry {
+	std::mutex mutex;
+	std::vector< std::unique_ptr< ThreadEvents > > threads;
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry &registry() {
+	static Registry *r = new Registry; //(never destroyed, so threads may record during exit)
+	return *r;
+}
+
+ThreadEvents &thread_events() {
+	static thread_local ThreadEvents *mine = nullptr;
+	if (!mine) {
+		Registry &r = registry();
+		std::unique_lock< std::mutex > lock(r.mutex);
+		r.threads.emplace_back(new ThreadEvents);
+		mine = r.threads.back().get();
+		mine->tid = uint32_t(r.threads.size());
+		mine->name = "thread " + std::to_string(mine->tid);
+	}
+	return *mine;
+}
+
+}
+
+std::atomic< bool > &Profiler::on_flag() {
+	static std::atomic< bool > on{false};
+	return on;
+}
+
+uint64_t Profiler::now() {
+	return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now() - registry().epoch).count());
+}
+
+void Profiler::record(char const *name, uint64_t begin, uint64_t end) {
+	ThreadEvents &te = thread_events();
+	uint64_t head = te.head.load(std::memory_order_relaxed);
+	Event &event = te.events[head % ThreadEvents::Capacity];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+	te.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::set_thread_name(std::string const &name) {
+	ThreadEvents &te = thread_events();
+	std::unique_lock< std::mutex > lock(registry().mutex);
+	te.name = name;
+}
+
+//write 's' as a JSON string:
+static void write_json_string(std::ostream &to, char const *s) {
+	to << '"';
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') to << '\\' << *s;
+		else if (uint8_t(*s) < 0x20) to << ' ';
+		else to << *s;
+	}
+	to << '"';
+}
+
+void Profiler::write_trace(std::string const &filename) {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "' to write a trace.");
+	}
+
+	Registry &r = registry();
+	std::unique_lock< std::mutex > lock(r.mutex);
+
+	std::vector< Event > events;
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (auto const &te : r.threads) {
+		//copy out the events still in the ring, then drop any that were overwritten while copying:
+		uint64_t head = te->head.load(std::memory_order_acquire);
+		uint64_t begin = (head > ThreadEvents::Capacity ? head - ThreadEvents::Capacity : 0);
+		events.clear();
+		for (uint64_t k = begin; k < head; ++k) {
+			events.emplace_back(te->events[k % ThreadEvents::Capacity]);
+		}
+		uint64_t head_after = te->head.load(std::memory_order_acquire);
+		// (including the one the writer may be in the middle of)
+		uint64_t valid = (head_after + 1 > ThreadEvents::Capacity ? head_after + 1 - ThreadEvents::Capacity : 0);
+		size_t skip = size_t(valid > begin ? std::min(valid - begin, uint64_t(events.size())) : 0);
+
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << te->tid << ",\"args\":{\"name\":";
+		write_json_string(file, te->name.c_str());
+		file << "}}";
+		first = false;
+
+		for (size_t i = skip; i < events.size(); ++i) {
+			Event const &e = events[i];
+			char times[64];
+			std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", e.begin / 1000.0, (e.end - e.begin) / 1000.0);
+			file << ",\n{\"name\":";
+			write_json_string(file, e.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << te->tid << "," << times << "}";
+		}
+	}
+	file << "\n]}\n";
+
+	if (!file) {
+		throw std::runtime_error("Failed to write trace to '" + filename + "'.");
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+//Profiler records how long marked sections of code take, on any thread, and writes them out
+// as a Chrome trace (load the file in chrome://tracing or https://ui.perfetto.dev):
+//
+//   void Game::draw(...) {
+//     PROFILE_SCOPE("Game::draw"); //times from here to the end of the enclosing block
+//     ...
+//   }
+//
+//Recording is off until Profiler::enable(true); while off, a scope costs one relaxed load and a branch.
+//Building with -DNO_PROFILER removes scopes entirely.
+//
+//Each thread writes its own fixed-size ring of events (allocated on its first event), so recording
+// takes no locks; the oldest events are overwritten once a ring is full.
+//write_trace() may be called from any thread while others keep recording.
+
+struct Profiler {
+	static void enable(bool on) { on_flag().store(on, std::memory_order_relaxed); }
+	static bool enabled() { return on_flag().load(std::memory_order_relaxed); }
+
+	//nanoseconds since the profiler's epoch:
+	static uint64_t now();
+
+	//record a section that ran from 'begin' to 'end' on the calling thread;
+	// 'name' must stay valid until the trace is written (e.g., a string literal):
+	static void record(char const *name, uint64_t begin, uint64_t end);
+
+	//label the calling thread in traces (e.g., "main", "loader"):
+	static void set_thread_name(std::string const &name);
+
+	//write every recorded event as Chrome trace-event JSON; throws on failure:
+	static void write_trace(std::string const &filename);
+
+	//times its own lifetime:
+	struct Scope {
+		Scope(char const *name_) : name(name_), active(enabled()) {
+			if (active) begin = now();
+		}
+		~Scope() {
+			if (active) record(name, begin, now());
+		}
+		Scope(Scope const &) = delete;
+		Scope &operator=(Scope const &) = delete;
+
+		char const *name;
+		bool active;
+		uint64_t begin = 0;
+	};
+
+	static std::atomic< bool > &on_flag();
+};
+
+#define PROFILE_CONCAT2(A, B) A ## B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT2(A, B)
+
+#ifdef NO_PROFILER
+#define PROFILE_SCOPE(NAME) do { } while(0)
+#else
+#define PROFILE_SCOPE(NAME) Profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(NAME)
+#endif
@@ -0,0 +1,161 @@
+#include "RenderQueue.hpp"
+
+#include "gl_errors.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+RenderQueue::RenderQueue() {
+}
+
+RenderQueue::~RenderQueue() {
+	if (transforms_tex != -1U) {
+		glDeleteTextures(1, &transforms_tex);
+		transforms_tex = -1U;
+	}
+}
+
+void RenderQueue::add(Pass pass, Pipeline const &pipeline, Mesh const &mesh, glm::mat4 const &object_to_world, uint32_t lod) {
+	assert(lod <= mesh.lod_count);
+	items.emplace_back();
+	Item &item = items.back();
+	item.pass = pass;
+	item.pipeline = &pipeline;
+	item.mesh = &mesh;
+	item.lod = lod;
+	item.object = uint32_t(objects.size());
+	objects.emplace_back(object_to_world);
+}
+
+void RenderQueue::prepare() {
+	//meshes are ordered by when they were first queued, not by address, so that draw order (which
+	// decides which of two overlapping objects wins) is the same from run to run:
+	mesh_orders.clear();
+	for (uint32_t i = 0; i < items.size(); ++i) {
+		items[i].mesh_order = mesh_orders.emplace(items[i].mesh, i).first->second;
+	}
+
+	//sort by pass, then by state; stable, so copies of a mesh keep the order they were queued in:
+	std::stable_sort(items.begin(), items.end(), [](Item const &a, Item const &b) {
+		if (a.pass != b.pass) return a.pass < b.pass;
+		if (a.pipeline->program != b.pipeline->program) return a.pipeline->program < b.pipeline->program;
+		if (a.pipeline->vao != b.pipeline->vao) return a.pipeline->vao < b.pipeline->vao;
+		if (a.mesh_order != b.mesh_order) return a.mesh_order < b.mesh_order;
+		return a.lod < b.lod;
+	});
+
+	//write transforms in sorted order, so each run of items is a contiguous range of transforms:
+	transforms.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i) {
+		Mesh const &mesh = *items[i].mesh;
+		glm::mat4 const &object_to_world = objects[items[i].object];
+
+		//fold the mesh's dequantization into the object-to-world transform:
+		glm::mat4 dequantize = glm::mat4(
+				mesh.position_scale.x, 0.0f, 0.0f, 0.0f,
+				0.0f, mesh.position_scale.y, 0.0f, 0.0f,
+				0.0f, 0.0f, mesh.position_scale.z, 0.0f,
+				mesh.position_offset.x, mesh.position_offset.y, mesh.position_offset.z, 1.0f);
+		glm::mat4 position_to_world = object_to_world * dequantize;
+		//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
+		glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
+
+		Transform &transform = transforms[i];
+		for (uint32_t r = 0; r < 3; ++r) {
+			transform.object_to_world[r] = glm::vec4(position_to_world[0][r], position_to_world[1][r], position_to_world[2][r], position_to_world[3][r]);
+			transform.normal_to_world[r] = glm::vec4(normal_to_world[0][r], normal_to_world[1][r], normal_to_world[2][r], 0.0f);
+		}
+	}
+}
+
+void RenderQueue::submit() {
+	PROFILE_SCOPE("RenderQueue::submit");
+	submitted_items = uint32_t(items.size());
+	submitted_draws = 0;
+	submitted_vertices = 0;
+	if (items.empty()) return;
+
+	prepare();
+
+	if (transforms_tex == -1U) {
+		glGenTextures(1, &transforms_tex);
+
+		//the buffer texture views the whole ring, so every region together must fit in GL_MAX_TEXTURE_BUFFER_SIZE:
+		GLint max_texels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+		transforms_per_upload = size_t(max_texels) * sizeof(glm::vec4) / RingBuffer::Regions / sizeof(Transform);
+		if (transforms_per_upload == 0) {
+			throw std::runtime_error("GL_MAX_TEXTURE_BUFFER_SIZE is too small to hold any transforms.");
+		}
+		transforms_ring.max_region_size = transforms_per_upload * sizeof(Transform);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + TransformsUnit);
+
+	GLuint bound_program = -1U;
+	GLuint bound_vao = -1U;
+	//items are drawn in batches of at most transforms_per_upload (usually just one batch):
+	for (size_t batch_begin = 0, batch_end = 0; batch_begin < items.size(); batch_begin = batch_end) {
+		batch_end = std::min(items.size(), batch_begin + transforms_per_upload);
+
+		//stream the batch's transforms into the ring buffer:
+		GLintptr offset = transforms_ring.upload(&transforms[batch_begin], (batch_end - batch_begin) * sizeof(Transform));
+		if (transforms_ring.buffer != transforms_tex_buffer) {
+			//(ring buffer was (re)allocated)
+			transforms_tex_buffer = transforms_ring.buffer;
+			glBindTexture(GL_TEXTURE_BUFFER, transforms_tex);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transforms_tex_buffer);
+		}
+		glBindTexture(GL_TEXTURE_BUFFER, transforms_tex);
+		//(so that item i's transform is at texel 6 * (base + i))
+		GLint base = GLint(offset / sizeof(Transform)) - GLint(batch_begin);
+
+		//draw each run of items that share pass, pipeline, mesh, and level of detail with one call:
+		for (size_t begin = batch_begin, end = batch_begin; begin < batch_end; begin = end) {
+			Item const &item = items[begin];
+			for (end = begin + 1; end < batch_end; ++end) {
+				if (items[end].pass != item.pass || items[end].pipeline != item.pipeline || items[end].mesh != item.mesh || items[end].lod != item.lod) break;
+			}
+
+			if (on_pass && (begin == 0 || items[begin-1].pass != item.pass)) {
+				on_pass(item.pass);
+			}
+
+			if (item.pipeline->program != bound_program) {
+				bound_program = item.pipeline->program;
+				glUseProgram(bound_program);
+			}
+			if (item.pipeline->vao != bound_vao) {
+				bound_vao = item.pipeline->vao;
+				glBindVertexArray(bound_vao);
+			}
+			glUniform1i(item.pipeline->first_transform_int, base + GLint(begin));
+
+			Mesh const &mesh = *item.mesh;
+			GLsizei copies = GLsizei(end - begin);
+			GLuint index_first = (item.lod ? mesh.lods[item.lod-1].index_first : mesh.index_first);
+			GLsizei index_count = (item.lod ? mesh.lods[item.lod-1].index_count : mesh.index_count);
+			if (index_count) {
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, (GLbyte *)0 + index_first * sizeof(uint16_t), copies, mesh.first);
+			} else {
+				glDrawArraysInstanced(GL_TRIANGLES, mesh.first, mesh.count, copies);
+			}
+			submitted_draws += 1;
+			submitted_vertices += uint32_t(copies) * uint32_t(index_count ? index_count : mesh.count);
+		}
+
+		//the region just written can't be reused until these draws finish:
+		transforms_ring.fence();
+	}
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	items.clear();
+	objects.clear();
+
+	GL_ERRORS();
+}
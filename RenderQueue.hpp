@@ -0,0 +1,100 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Mesh.hpp"
+#include "RingBuffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+//RenderQueue collects everything to be drawn in a frame as (pass, pipeline, mesh, transform) items,
+// then submits them all at once:
+// - passes are drawn in order; within a pass, items are sorted by program and vertex array, so state
+//   changes happen as rarely as possible, and then grouped by mesh, with meshes in the order they were
+//   first queued (so when every copy of each mesh is queued together, draw order is queue order);
+// - every run of items sharing a mesh (and level of detail) becomes a single instanced draw;
+// - the transforms of all items are streamed to the GPU through a RingBuffer, in one upload unless
+//   there are more than a buffer texture can hold (GL_MAX_TEXTURE_BUFFER_SIZE may be as small as
+//   65536 texels, about 3.6k transforms across the ring's regions), in which case the items are
+//   drawn in batches of that many, each with its own upload.
+//
+//Programs used with RenderQueue read their per-copy transforms from a samplerBuffer on
+// texture unit TransformsUnit, six texels per copy (see Transform), starting at
+// texel 6 * (first_transform + gl_InstanceID), where first_transform is an int uniform.
+
+struct RenderQueue {
+	RenderQueue();
+	~RenderQueue();
+
+	RenderQueue(RenderQueue const &) = delete;
+	RenderQueue &operator=(RenderQueue const &) = delete;
+
+	enum Pass : uint8_t {
+		BackgroundPass = 0,
+		ObjectsPass = 1,
+		HUDPass = 2,
+		PassCount
+	};
+
+	enum : GLuint { TransformsUnit = 0 };
+
+	//how to draw a mesh:
+	struct Pipeline {
+		GLuint program = -1U;
+		GLuint vao = -1U; //vertex array object connecting the mesh buffers to the program
+		GLuint first_transform_int = -1U; //location of the program's first_transform uniform
+	};
+
+	//queue a copy of 'mesh' to be drawn with 'object_to_world' during 'pass':
+	// (pipeline and mesh must stay alive until submit())
+	//'lod' picks the triangles drawn: 0 for the full mesh, or n for mesh.lods[n-1] (see Mesh.hpp)
+	void add(Pass pass, Pipeline const &pipeline, Mesh const &mesh, glm::mat4 const &object_to_world, uint32_t lod = 0);
+
+	//draw (and then clear) everything queued since the last submit:
+	void submit();
+
+	//the part of submit() that doesn't touch OpenGL: sort 'items' into draw order and
+	// fill 'transforms' to match (so it can be run, e.g. by benchmarks, without a context):
+	void prepare();
+
+	//if set, called during submit() just before the first draw of each pass that has any items
+	// (e.g., to place GPU timer queries):
+	std::function< void(Pass) > on_pass;
+
+	//counts from the most recent submit():
+	uint32_t submitted_items = 0;
+	uint32_t submitted_draws = 0;
+	uint32_t submitted_vertices = 0; //vertices processed (counting each copy; for indexed meshes, indices)
+
+	//per-copy transform, as read by the shader (six RGBA32F texels):
+	// (matrices are stored as rows so that each fits in three vec4s)
+	struct Transform {
+		glm::vec4 object_to_world[3]; //includes the mesh's dequantization
+		glm::vec4 normal_to_world[3]; //(w unused)
+	};
+	static_assert(sizeof(Transform) == 96, "Transform should be packed.");
+
+	//------- internals -------
+	struct Item {
+		Pass pass;
+		Pipeline const *pipeline;
+		Mesh const *mesh;
+		uint32_t lod; //(as passed to add())
+		uint32_t object; //index into 'objects'
+		uint32_t mesh_order; //(set by prepare(): index of the first item queued with this mesh)
+	};
+
+	//frame-local storage (kept to reuse its allocations from frame to frame):
+	std::vector< Item > items;
+	std::vector< glm::mat4 > objects;
+	std::vector< Transform > transforms;
+	std::unordered_map< Mesh const *, uint32_t > mesh_orders; //(scratch space for prepare)
+
+	RingBuffer transforms_ring{GL_TEXTURE_BUFFER, sizeof(Transform)}; //triple-buffered storage for 'transforms'
+	GLuint transforms_tex = -1U; //buffer texture that views transforms_ring.buffer (created on first submit)
+	size_t transforms_per_upload = 0; //most transforms that fit in one region of the ring (set on first submit)
+	GLuint transforms_tex_buffer = 0; //buffer currently attached to transforms_tex
+};
@@ -0,0 +1,75 @@
+#include "Replay.hpp"
+
+#include "read_chunk.hpp"
+#include "write_chunk.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <cassert>
+
+void Replay::record(uint64_t tick, GameState::Action action, bool pressed) {
+	if (tick > 0xffffffffU) {
+		throw std::runtime_error("Session too long to record.");
+	}
+	Input input;
+	input.tick = uint32_t(tick);
+	input.action = uint8_t(action);
+	input.pressed = pressed ? 1 : 0;
+	inputs.emplace_back(input);
+}
+
+void Replay::save(std::string const &filename) const {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "' to write a replay.");
+	}
+	write_chunk("rpl0", std::vector< Header >(1, header), &file);
+	write_chunk("inp0", inputs, &file);
+	if (!file) {
+		throw std::runtime_error("Failed to write replay to '" + filename + "'.");
+	}
+}
+
+void Replay::load(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open replay '" + filename + "'.");
+	}
+	std::vector< Header > headers;
+	read_chunk(file, "rpl0", &headers);
+	if (headers.size() != 1) {
+		throw std::runtime_error("Replay '" + filename + "' should have exactly one header.");
+	}
+	header = headers[0];
+	if (!(header.tick_rate > 0.0f)) {
+		throw std::runtime_error("Replay '" + filename + "' has an invalid step rate.");
+	}
+	read_chunk(file, "inp0", &inputs);
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		if (inputs[i].action > GameState::ActionRestart
+		 || (i > 0 && inputs[i].tick < inputs[i-1].tick)) {
+			throw std::runtime_error("Replay '" + filename + "' has invalid inputs.");
+		}
+	}
+}
+
+void Replay::apply(uint64_t tick, size_t *next, GameState *state) const {
+	assert(next);
+	assert(state);
+	while (*next < inputs.size() && inputs[*next].tick <= tick) {
+		Input const &input = inputs[*next];
+		state->handle_action(GameState::Action(input.action), input.pressed != 0);
+		*next += 1;
+	}
+}
+
+void Replay::play(GameState *state) const {
+	assert(state);
+	//(must step exactly as Game::update does)
+	float tick = 1.0f / header.tick_rate;
+	size_t next = 0;
+	for (uint64_t t = 0; t < header.ticks; ++t) {
+		apply(t, &next, state);
+		state->update(tick);
+	}
+}
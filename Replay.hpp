@@ -0,0 +1,49 @@
+#pragma once
+
+#include "GameState.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//A Replay is everything needed to play a game again exactly:
+// the seed, the step rate, and every input along with the step it arrived before.
+//Since GameState only changes through handle_action and fixed-size update steps,
+// feeding it the same inputs at the same steps always ends in the same state (compare with GameState::hash).
+//
+//Replays are stored as two chunks (see read_chunk.hpp):
+// "rpl0" -- one Header
+// "inp0" -- Inputs, in order
+
+struct Replay {
+	struct Header {
+		uint64_t seed = 0;
+		uint64_t ticks = 0; //length of the session, in steps
+		float tick_rate = 120.0f; //steps per second
+		uint32_t reserved = 0;
+	};
+	static_assert(sizeof(Header) == 24, "Header is packed.");
+
+	struct Input {
+		uint32_t tick = 0; //applied just before this step
+		uint8_t action = 0; //(a GameState::Action)
+		uint8_t pressed = 0;
+		uint8_t reserved[2] = {0, 0};
+	};
+	static_assert(sizeof(Input) == 8, "Input is packed.");
+
+	Header header;
+	std::vector< Input > inputs;
+
+	void record(uint64_t tick, GameState::Action action, bool pressed);
+
+	//throw on failure:
+	void save(std::string const &filename) const;
+	void load(std::string const &filename);
+
+	//pass the inputs for step 'tick' to 'state', starting from inputs[*next] (which is advanced past them):
+	void apply(uint64_t tick, size_t *next, GameState *state) const;
+
+	//run the whole session on 'state' (which should be freshly constructed with header.seed):
+	void play(GameState *state) const;
+};
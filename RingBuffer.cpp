@@ -0,0 +1,146 @@
+#include "RingBuffer.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+//glBufferStorage is GL 4.4 (or ARB_buffer_storage), so it isn't part of the GL 3.3 prototypes;
+// it is looked up on first use and left null if not supported:
+static PFNGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+static bool looked_up_BufferStorage = false;
+
+static void *sdl_get_proc_address(char const *name) {
+	return SDL_GL_GetProcAddress(name);
+}
+void *(*RingBuffer::get_proc_address)(char const *name) = sdl_get_proc_address;
+
+//(checked through GL itself, so this works whether or not SDL made the context)
+static bool extension_supported(char const *name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		char const *extension = reinterpret_cast< char const * >(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+		if (extension && std::strcmp(extension, name) == 0) return true;
+	}
+	return false;
+}
+
+RingBuffer::RingBuffer(GLenum target_, size_t alignment_) : target(target_), alignment(alignment_) {
+	if (alignment == 0) {
+		throw std::runtime_error("RingBuffer alignment must be nonzero.");
+	}
+}
+
+RingBuffer::~RingBuffer() {
+	release();
+}
+
+GLintptr RingBuffer::upload(void const *data, size_t size) {
+	if (max_region_size && size > max_region_size) {
+		throw std::runtime_error("RingBuffer upload is larger than max_region_size.");
+	}
+	if (buffer == 0 || size > region_size) {
+		//start at 16k and at least double on every resize, so growth happens rarely:
+		size_t grown = std::max(size, std::max< size_t >(2 * region_size, 16384));
+		if (max_region_size) grown = std::min(grown, max_region_size);
+		allocate(grown);
+	}
+
+	if (!persistent) {
+		//orphan the old storage (draws in flight keep using it) and write the new data at the start:
+		glBindBuffer(target, buffer);
+		glBufferData(target, region_size, nullptr, GL_STREAM_DRAW);
+		if (size) {
+			void *dst = glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (!dst) {
+				glBindBuffer(target, 0);
+				throw std::runtime_error("Failed to map RingBuffer for writing.");
+			}
+			std::memcpy(dst, data, size);
+			glUnmapBuffer(target);
+		}
+		glBindBuffer(target, 0);
+		return 0;
+	}
+
+	region = (region + 1) % Regions;
+	wait(region);
+	std::memcpy(mapped + region * region_size, data, size);
+	//(mapping is coherent, so the write is visible to draws issued after this without a flush)
+	return GLintptr(region * region_size);
+}
+
+void RingBuffer::fence() {
+	if (!persistent) return;
+	if (fences[region]) glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void RingBuffer::allocate(size_t size) {
+	release();
+
+	if (!looked_up_BufferStorage) {
+		looked_up_BufferStorage = true;
+		if (extension_supported("GL_ARB_buffer_storage")) {
+			BufferStorage = (PFNGLBUFFERSTORAGEPROC)get_proc_address("glBufferStorage");
+		}
+	}
+
+	region_size = (size + alignment - 1) / alignment * alignment;
+	region = Regions - 1;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	if (BufferStorage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		BufferStorage(target, Regions * region_size, nullptr, flags);
+		mapped = reinterpret_cast< uint8_t * >(glMapBufferRange(target, 0, Regions * region_size, flags));
+		persistent = (mapped != nullptr);
+	}
+	if (!persistent) {
+		//(also reached if persistent mapping failed; storage is immutable, so start over with a fresh buffer)
+		if (BufferStorage) {
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(target, buffer);
+		}
+		glBufferData(target, region_size, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(target, 0);
+}
+
+void RingBuffer::release() {
+	//draws still reading the old buffer keep it alive until they finish, so no need to wait on fences:
+	for (GLsync &f : fences) {
+		if (f) {
+			glDeleteSync(f);
+			f = nullptr;
+		}
+	}
+	if (buffer == 0) return;
+	if (mapped) {
+		glBindBuffer(target, buffer);
+		glUnmapBuffer(target);
+		glBindBuffer(target, 0);
+		mapped = nullptr;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	persistent = false;
+}
+
+void RingBuffer::wait(size_t r) {
+	if (!fences[r]) return;
+	GLenum status = glClientWaitSync(fences[r], 0, 0);
+	while (status == GL_TIMEOUT_EXPIRED) {
+		//flush so the fence is guaranteed to signal eventually, then block (up to a second at a time):
+		status = glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+	}
+	glDeleteSync(fences[r]);
+	fences[r] = nullptr;
+	if (status == GL_WAIT_FAILED) {
+		throw std::runtime_error("Failed waiting on RingBuffer fence.");
+	}
+}
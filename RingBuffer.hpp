@@ -0,0 +1,61 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+//RingBuffer streams data that is rewritten every frame (e.g., per-draw transforms) to the GPU
+// without stalling on draws from previous frames that may still be reading it.
+//
+//If ARB_buffer_storage is available, the buffer is persistently mapped once and split into
+// three regions which are written round-robin, one per upload; a fence placed after each frame's
+// draws tells later uploads when a region is safe to reuse.
+//Otherwise, each upload orphans the buffer and writes it through glMapBufferRange, leaving the
+// driver to keep older contents around for draws still in flight.
+//
+//Usage (once per frame):
+//  GLintptr offset = ring.upload(data, size); //copy data into the next region (waiting on its fence if needed)
+//  ...issue draws that read from ring.buffer at offset...
+//  ring.fence(); //mark the region as in-use until those draws complete
+//
+//Note: 'buffer' may be replaced by a larger buffer during upload(); callers that attach it
+// elsewhere (e.g., to a buffer texture) should check for that.
+
+struct RingBuffer {
+	//'alignment' is a size that each region's offset will be a multiple of (e.g., the size of one record):
+	RingBuffer(GLenum target, size_t alignment = 256);
+	~RingBuffer();
+
+	RingBuffer(RingBuffer const &) = delete;
+	RingBuffer &operator=(RingBuffer const &) = delete;
+
+	//copy 'size' bytes into the next region (growing the buffer if needed); returns their offset in 'buffer':
+	// (throws if 'size' is more than max_region_size)
+	GLintptr upload(void const *data, size_t size);
+
+	//place a fence after the draws that read the most recent upload:
+	void fence();
+
+	enum : size_t { Regions = 3 };
+
+	//how extension functions (glBufferStorage) are found -- SDL_GL_GetProcAddress, unless replaced
+	// before the first upload (e.g., for a context SDL didn't create; see Offscreen):
+	static void *(*get_proc_address)(char const *name);
+
+	GLenum target; //binding point used when (re)allocating and mapping
+	size_t alignment;
+	GLuint buffer = 0; //buffer object; 0 until the first upload
+	size_t region_size = 0; //size of each region in bytes
+	size_t max_region_size = 0; //if nonzero, regions never grow past this (a multiple of 'alignment'; e.g., to fit a buffer texture)
+	size_t region = Regions - 1; //region used by the most recent upload
+
+	bool persistent = false; //using a persistently-mapped buffer (ARB_buffer_storage)?
+	uint8_t *mapped = nullptr; //start of the persistent mapping (if persistent)
+	GLsync fences[Regions] = {nullptr, nullptr, nullptr}; //per-region fence (only used if persistent)
+
+	//------- internals -------
+	void allocate(size_t size); //(re)create the buffer with room for 'size' bytes per region
+	void release();
+	void wait(size_t region); //wait on (and delete) a region's fence
+};
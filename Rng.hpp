@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+//Rng is a small, fast pseudo-random number generator (PCG32, see https://www.pcg-random.org/).
+//It has 8 bytes of state (the stream increment is a fixed constant), needs no system calls to seed,
+// and gives the same sequence on every platform for a given seed -- so a seed is enough to reproduce a game.
+//It satisfies the standard UniformRandomBitGenerator requirements, so it also works with <random> distributions.
+
+struct Rng {
+	typedef uint32_t result_type;
+
+	explicit Rng(uint64_t seed_ = 0) { seed(seed_); }
+
+	void seed(uint64_t seed_) {
+		state = 0;
+		(*this)();
+		state += seed_;
+		(*this)();
+	}
+
+	uint32_t operator()() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + Increment;
+		uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = uint32_t(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((-rot) & 31u));
+	}
+
+	static constexpr uint32_t min() { return 0; }
+	static constexpr uint32_t max() { return 0xffffffffU; }
+
+	static constexpr uint64_t Increment = 1442695040888963407ULL; //(must be odd)
+	uint64_t state = 0;
+};
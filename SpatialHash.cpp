@@ -0,0 +1,192 @@
+#include "SpatialHash.hpp"
+
+#include <cassert>
+
+//count_neighbors() tests four points at a time with SSE2 where the compiler targets it:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPATIAL_HASH_SSE 1
+#endif
+
+void SpatialHash::build(float cell_size, glm::vec2 const *points, uint32_t count) {
+	build(cell_size, count ? &points[0].x : nullptr, count ? &points[0].y : nullptr, count, 2);
+}
+
+void SpatialHash::build(float cell_size, float const *xs, float const *ys, uint32_t count) {
+	build(cell_size, xs, ys, count, 1);
+}
+
+void SpatialHash::build(float cell_size_, float const *xs, float const *ys, uint32_t count, uint32_t stride) {
+	cell_size = cell_size_;
+	inv_cell_size = 1.0f / cell_size;
+
+	//about two buckets per point keeps hash collisions rare:
+	// (and at least four, so the three buckets of a query column never overlap themselves)
+	uint32_t buckets = 4;
+	while (buckets < 2 * count) buckets *= 2;
+	bucket_mask = buckets - 1;
+
+	//count points per bucket, then sum so that bucket_begin[b] is the end of bucket b:
+	bucket_begin.assign(buckets + 1, 0);
+	unsorted.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		Entry &entry = unsorted[i];
+		entry.position = glm::vec2(xs[i * stride], ys[i * stride]);
+		entry.cell_x = cell_coord(entry.position.x);
+		entry.cell_y = cell_coord(entry.position.y);
+		entry.index = i;
+		bucket_begin[bucket(entry.cell_x, entry.cell_y)] += 1;
+	}
+	for (uint32_t b = 1; b < buckets; ++b) {
+		bucket_begin[b] += bucket_begin[b-1];
+	}
+	bucket_begin[buckets] = count;
+
+	//scatter entries into their buckets, last first, moving each end back to the bucket's start:
+	// (so entries stay in order of index within each bucket)
+	entries.resize(count);
+	for (uint32_t i = count; i > 0; --i) {
+		Entry const &entry = unsorted[i-1];
+		entries[--bucket_begin[bucket(entry.cell_x, entry.cell_y)]] = entry;
+	}
+}
+
+//PairCounter tests one point against ranges of entries (copied into the padded arrays 'sorted'),
+// adding one to the point's count and to the other point's for every pair within the radius:
+namespace {
+struct Sorted {
+	float const *x;
+	float const *y;
+	int32_t const *cell_x;
+	int32_t const *cell_y;
+	uint32_t *found;
+};
+
+#if defined(SPATIAL_HASH_SSE)
+
+//four entries at a time (the arrays are padded, so reading past the end of a range is fine; those lanes are masked off):
+struct PairCounter {
+	PairCounter(Sorted const &sorted_, glm::vec2 center, float radius2_) : sorted(sorted_),
+		center_x(_mm_set1_ps(center.x)), center_y(_mm_set1_ps(center.y)), radius2(_mm_set1_ps(radius2_)), mine(_mm_setzero_si128()) { }
+
+	//count points in [begin,end) that are in column x, rows [y0,y1]:
+	void visit(uint32_t begin, uint32_t end, int32_t x, int32_t y0, int32_t y1) {
+		__m128i const column = _mm_set1_epi32(x);
+		__m128i const below = _mm_set1_epi32(y0 - 1), above = _mm_set1_epi32(y1 + 1);
+		__m128i const lanes = _mm_setr_epi32(0, 1, 2, 3);
+		for (uint32_t o = begin; o < end; o += 4) {
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(sorted.x + o), center_x);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(sorted.y + o), center_y);
+			__m128i hit = _mm_castps_si128(_mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), radius2));
+			__m128i cx = _mm_loadu_si128(reinterpret_cast< __m128i const * >(sorted.cell_x + o));
+			__m128i cy = _mm_loadu_si128(reinterpret_cast< __m128i const * >(sorted.cell_y + o));
+			hit = _mm_and_si128(hit, _mm_cmpeq_epi32(cx, column));
+			hit = _mm_and_si128(hit, _mm_and_si128(_mm_cmpgt_epi32(cy, below), _mm_cmplt_epi32(cy, above)));
+			hit = _mm_and_si128(hit, _mm_cmplt_epi32(lanes, _mm_set1_epi32(int32_t(end - o))));
+			//(hit lanes are all ones, i.e. -1, so subtracting adds one)
+			mine = _mm_sub_epi32(mine, hit);
+			__m128i *found = reinterpret_cast< __m128i * >(sorted.found + o);
+			_mm_storeu_si128(found, _mm_sub_epi32(_mm_loadu_si128(found), hit));
+		}
+	}
+
+	uint32_t total() const {
+		__m128i sum = _mm_add_epi32(mine, _mm_shuffle_epi32(mine, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		return uint32_t(_mm_cvtsi128_si32(sum));
+	}
+
+	Sorted const &sorted;
+	__m128 center_x, center_y, radius2;
+	__m128i mine;
+};
+
+#else
+
+struct PairCounter {
+	PairCounter(Sorted const &sorted_, glm::vec2 center_, float radius2_) : sorted(sorted_), center(center_), radius2(radius2_) { }
+
+	//count points in [begin,end) that are in column x, rows [y0,y1] (without branching on the results):
+	void visit(uint32_t begin, uint32_t end, int32_t x, int32_t y0, int32_t y1) {
+		for (uint32_t o = begin; o < end; ++o) {
+			float dx = sorted.x[o] - center.x;
+			float dy = sorted.y[o] - center.y;
+			//(y0 <= cell_y <= y1 as one unsigned compare)
+			uint32_t hit = uint32_t(sorted.cell_x[o] == x) & uint32_t(uint32_t(sorted.cell_y[o]) - uint32_t(y0) <= uint32_t(y1 - y0))
+			             & uint32_t(dx * dx + dy * dy <= radius2);
+			mine += hit;
+			sorted.found[o] += hit;
+		}
+	}
+
+	uint32_t total() const { return mine; }
+
+	Sorted const &sorted;
+	glm::vec2 center;
+	float radius2;
+	uint32_t mine = 0;
+};
+
+#endif
+} //namespace
+
+void SpatialHash::count_neighbors(float radius, std::vector< uint32_t > *counts_) {
+	assert(counts_);
+	auto &counts = *counts_;
+	float radius2 = radius * radius;
+	uint32_t buckets = bucket_mask + 1;
+	uint32_t count = uint32_t(entries.size());
+
+	//entries are copied into separate arrays (padded by a few, for PairCounter), and counts are
+	// gathered in entry order, so each pair adds to two nearby counters:
+	uint32_t padded = count + 4;
+	sorted_x.assign(padded, 0.0f);
+	sorted_y.assign(padded, 0.0f);
+	sorted_cell_x.assign(padded, 0);
+	sorted_cell_y.assign(padded, 0);
+	entry_counts.assign(padded, 0);
+	for (uint32_t e = 0; e < count; ++e) {
+		sorted_x[e] = entries[e].position.x;
+		sorted_y[e] = entries[e].position.y;
+		sorted_cell_x[e] = entries[e].cell_x;
+		sorted_cell_y[e] = entries[e].cell_y;
+	}
+	Sorted sorted;
+	sorted.x = sorted_x.data();
+	sorted.y = sorted_y.data();
+	sorted.cell_x = sorted_cell_x.data();
+	sorted.cell_y = sorted_cell_y.data();
+	sorted.found = entry_counts.data();
+
+	uint32_t const *begins = bucket_begin.data();
+	for (uint32_t e = 0; e < count; ++e) {
+		int32_t cell_x = sorted.cell_x[e];
+		int32_t cell_y = sorted.cell_y[e];
+		PairCounter counter(sorted, glm::vec2(sorted.x[e], sorted.y[e]), radius2);
+
+		//the rest of e's cell and the cell above it (the next bucket), as one range starting after e:
+		uint32_t b = bucket(cell_x, cell_y);
+		if (b + 2 <= buckets) {
+			counter.visit(e + 1, begins[b + 2], cell_x, cell_y, cell_y + 1);
+		} else {
+			counter.visit(e + 1, count, cell_x, cell_y, cell_y + 1);
+			counter.visit(0, begins[b + 2 - buckets], cell_x, cell_y, cell_y + 1);
+		}
+
+		//the three cells of the column to the right (as in query):
+		uint32_t r = bucket(cell_x + 1, cell_y - 1);
+		if (r + 3 <= buckets) {
+			counter.visit(begins[r], begins[r + 3], cell_x + 1, cell_y - 1, cell_y + 1);
+		} else {
+			counter.visit(begins[r], count, cell_x + 1, cell_y - 1, cell_y + 1);
+			counter.visit(0, begins[r + 3 - buckets], cell_x + 1, cell_y - 1, cell_y + 1);
+		}
+
+		sorted.found[e] += counter.total();
+	}
+
+	counts.resize(count);
+	for (uint32_t e = 0; e < count; ++e) {
+		counts[entries[e].index] = sorted.found[e];
+	}
+}
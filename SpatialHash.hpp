@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+//SpatialHash is a uniform grid over 2D points, stored as a hash table of cells so that it
+// needs no bounds and its size only depends on the number of points.
+//It is meant to be rebuilt whenever the points move (e.g., every simulation tick);
+// build() is a counting sort, so it costs O(points) and reuses its storage.
+//
+//Queries visit the 3x3 block of cells around their center, so query radii must be no
+// larger than the cell size. Cells in the same column hash to consecutive buckets, so
+// each query reads three contiguous runs of entries.
+//
+//A query costs about nine times the number of points per cell (count_neighbors, about five),
+// so the grid only helps while points are spread out: packing more points into the same area
+// makes testing every point quadratic again (e.g., 10k geese on the game's board take about
+// as long per tick as 100k spread two to a cell; see Stress::density).
+
+struct SpatialHash {
+	//bucket 'points' into cells of size 'cell_size':
+	void build(float cell_size, glm::vec2 const *points, uint32_t count);
+	void build(float cell_size, std::vector< glm::vec2 > const &points) {
+		build(cell_size, points.data(), uint32_t(points.size()));
+	}
+	//...or from separate arrays of coordinates:
+	void build(float cell_size, float const *xs, float const *ys, uint32_t count);
+
+	//call fn(index) for every point within 'radius' (<= cell_size) of 'center':
+	template< typename F >
+	void query(glm::vec2 center, float radius, F const &fn) const;
+
+	//set (*counts)[index] to the number of other points within 'radius' (<= cell_size) of each point:
+	// (much faster than querying around every point: each pair is tested once, from whichever point's
+	//  cell is lower-left, and counted without branching on the result -- four at a time with SSE2)
+	void count_neighbors(float radius, std::vector< uint32_t > *counts);
+
+	//------- internals -------
+	void build(float cell_size, float const *xs, float const *ys, uint32_t count, uint32_t stride);
+
+	struct Entry {
+		glm::vec2 position;
+		int32_t cell_x, cell_y; //(to skip other cells that hash to the same bucket)
+		uint32_t index; //index of point passed to build()
+	};
+
+	float cell_size = 1.0f;
+	float inv_cell_size = 1.0f;
+	uint32_t bucket_mask = 0; //bucket count minus one (bucket count is a power of two)
+	std::vector< uint32_t > bucket_begin; //entries of bucket b are [bucket_begin[b], bucket_begin[b+1])
+	std::vector< Entry > entries;
+	std::vector< Entry > unsorted; //(scratch space for build)
+	//(scratch space for count_neighbors: entries as separate arrays, and counts in entry order)
+	std::vector< float > sorted_x, sorted_y;
+	std::vector< int32_t > sorted_cell_x, sorted_cell_y;
+	std::vector< uint32_t > entry_counts;
+
+	int32_t cell_coord(float x) const {
+		return int32_t(std::floor(x * inv_cell_size));
+	}
+	uint32_t bucket(int32_t cell_x, int32_t cell_y) const {
+		return (uint32_t(cell_x) * 0x9e3779b1U + uint32_t(cell_y)) & bucket_mask;
+	}
+};
+
+template< typename F >
+void SpatialHash::query(glm::vec2 center, float radius, F const &fn) const {
+	if (entries.empty()) return;
+	float radius2 = radius * radius;
+	int32_t cx = cell_coord(center.x);
+	int32_t cy = cell_coord(center.y);
+	for (int32_t x = cx - 1; x <= cx + 1; ++x) {
+		auto visit = [&](uint32_t begin, uint32_t end) {
+			for (uint32_t e = begin; e < end; ++e) {
+				Entry const &entry = entries[e];
+				if (entry.cell_x != x || entry.cell_y < cy - 1 || entry.cell_y > cy + 1) continue;
+				glm::vec2 d = entry.position - center;
+				if (d.x * d.x + d.y * d.y <= radius2) fn(entry.index);
+			}
+		};
+		//the three cells of a column hash to consecutive buckets, so they are scanned as one range
+		// (in two pieces if it wraps around the end of the table):
+		uint32_t b = bucket(x, cy - 1);
+		if (b + 3 <= bucket_mask + 1) {
+			visit(bucket_begin[b], bucket_begin[b + 3]);
+		} else {
+			visit(bucket_begin[b], uint32_t(entries.size()));
+			visit(0, bucket_begin[b + 3 - (bucket_mask + 1)]);
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#include "Stress.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+bool Stress::parse(std::string const &arg) {
+	size_t eq = arg.find('=');
+	if (eq == std::string::npos) return false;
+	std::string key = arg.substr(0, eq);
+	std::string value = arg.substr(eq + 1);
+	try {
+		if (key == "eggs") {
+			eggs = uint32_t(std::stoul(value));
+		} else if (key == "geese") {
+			geese = uint32_t(std::stoul(value));
+		} else if (key == "seconds") {
+			seconds = std::stof(value);
+			if (!(seconds > 0.0f)) return false;
+		} else if (key == "density") {
+			density = std::stof(value);
+			if (!(density > 0.0f)) return false;
+		} else {
+			return false;
+		}
+	} catch (std::exception &) {
+		return false;
+	}
+	return true;
+}
+
+void Stress::populate(GameState *state) const {
+	state->start_targets = eggs;
+	state->start_geese = std::max(1U, geese);
+	//grow the 5 x 2.5 spawn area (see GameState::populate) until it holds 'density' geese per cell:
+	float cells = 5.0f * 2.5f / (state->min_r * state->min_r);
+	state->spawn_scale = std::max(1.0f, std::sqrt(float(state->start_geese) / (density * cells)));
+	state->populate();
+}
+
+Replay Stress::script(uint64_t seed, float tick_rate) const {
+	Replay replay;
+	replay.header.seed = seed;
+	replay.header.tick_rate = tick_rate;
+	replay.header.ticks = uint64_t(std::ceil(seconds * tick_rate));
+
+	//one round of inputs, as (seconds into round, action, pressed):
+	struct Step {
+		float at;
+		GameState::Action action;
+		bool pressed;
+	};
+	static Step const round[] = {
+		{0.0f, GameState::ActionRight, true},
+		{0.5f, GameState::ActionRight, false},
+		{0.6f, GameState::ActionJump, true},
+		{1.1f, GameState::ActionJump, false},
+		{2.2f, GameState::ActionLeft, true},
+		{2.7f, GameState::ActionLeft, false},
+		{2.8f, GameState::ActionRestart, true}, //(only does something once the game is over)
+		{2.9f, GameState::ActionRestart, false},
+	};
+	float const round_length = 3.0f;
+
+	for (uint64_t start = 0; start < replay.header.ticks; start += uint64_t(round_length * tick_rate)) {
+		for (Step const &step : round) {
+			uint64_t tick = start + uint64_t(step.at * tick_rate);
+			if (tick >= replay.header.ticks) break;
+			replay.record(tick, step.action, step.pressed);
+		}
+	}
+	return replay;
+}
+
+double Samples::percentile(double p) const {
+	if (values.empty()) return 0.0;
+	sorted = values;
+	size_t rank = size_t(std::ceil(p * sorted.size()));
+	rank = std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+void Samples::report(std::ostream &to, std::string const &name, std::string const &unit) const {
+	to << name << ": p50 " << percentile(0.5) << ", p90 " << percentile(0.9) << ", p99 " << percentile(0.99)
+	   << ", max " << percentile(1.0) << " " << unit << " (" << values.size() << " samples)" << std::endl;
+}
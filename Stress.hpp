@@ -0,0 +1,46 @@
+#pragma once
+
+#include "GameState.hpp"
+#include "Replay.hpp"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//Stress describes a scripted scenario for finding where update() and draw() stop scaling
+// (see --stress in main.cpp): a game with arbitrary populations of targets and geese,
+// played for a fixed number of seconds with the same inputs every time.
+
+struct Stress {
+	uint32_t eggs = 7; //targets on the board
+	uint32_t geese = 1; //geese at the start (more join as points are scored)
+	float seconds = 20.0f; //length of the scenario in simulated time
+	//starting geese per min_r-by-min_r cell (about what bench uses): once the board would be more
+	// crowded than this, geese spawn over a larger area instead, since every goose is tested against
+	// the others in its neighborhood and so a fixed area makes ticks quadratic in the number of geese:
+	float density = 2.0f;
+
+	//parse one "key=value" argument (eggs=N, geese=M, seconds=S, density=D); returns false if it isn't one:
+	bool parse(std::string const &arg);
+
+	//replace the populations (and, if needed, the spawn area) of a newly constructed 'state':
+	void populate(GameState *state) const;
+
+	//the scripted inputs -- turn, charge, jump, turn back, press restart, repeat -- as a replay:
+	Replay script(uint64_t seed, float tick_rate) const;
+};
+
+//Samples collects measurements (e.g., times in milliseconds) and reports their distribution:
+struct Samples {
+	std::vector< double > values;
+
+	void add(double value) { values.emplace_back(value); }
+
+	//value below which fraction 'p' (0 to 1) of the samples fall (nearest rank), or 0 with no samples:
+	double percentile(double p) const;
+
+	//one line: "name: p50 ..., p90 ..., p99 ..., max ... unit (N samples)":
+	void report(std::ostream &to, std::string const &name, std::string const &unit = "ms") const;
+
+	mutable std::vector< double > sorted; //(scratch space for percentile)
+};
@@ -0,0 +1,335 @@
+//bench times pieces of the game in isolation, without a window or OpenGL context.
+//Build and run it with:
+//   jam bench && dist/bench [--quick] [name ...]
+//('name' arguments select benchmarks whose names contain any of them.)
+//
+//Output is one tab-separated line per measurement, in a fixed order, so runs from two
+// commits can be compared with diff or a spreadsheet:
+//   <benchmark> <n> <iterations> <min_ns> <median_ns> <mean_ns>
+//where 'n' is the problem size (bytes, meshes, geese, targets, or draw items), 'iterations'
+// is how many calls each sample timed, and the times are per call.
+//Lines starting with '#' are comments.
+
+#include "read_chunk.hpp"
+#include "write_chunk.hpp"
+#include "MeshIndex.hpp"
+#include "RenderQueue.hpp"
+#include "GameState.hpp"
+#include "Stress.hpp" //Samples
+#include "Rng.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+
+static struct {
+	bool quick = false; //fewer, shorter samples (for a quick check rather than a comparison)
+	std::vector< std::string > filters; //run benchmarks whose names contain any of these (all, if empty)
+} options;
+
+//call 'fn' repeatedly and print one line of timings for it:
+// ('fn' should leave things as it found them, so every call does the same work)
+static void measure(std::string const &name, uint64_t n, std::function< void() > const &fn) {
+	if (!options.filters.empty()) {
+		bool selected = false;
+		for (auto const &filter : options.filters) {
+			if (name.find(filter) != std::string::npos) selected = true;
+		}
+		if (!selected) return;
+	}
+
+	typedef std::chrono::high_resolution_clock Clock;
+	auto time = [&fn](uint64_t iterations) -> double {
+		auto before = Clock::now();
+		for (uint64_t i = 0; i < iterations; ++i) {
+			fn();
+		}
+		auto after = Clock::now();
+		return std::chrono::duration< double, std::nano >(after - before).count();
+	};
+
+	//warm up (caches, allocations kept for reuse), then double the iterations until a sample is long enough to time well:
+	double const min_sample_ns = (options.quick ? 2e6 : 20e6);
+	uint32_t const sample_count = (options.quick ? 3 : 15);
+	uint64_t iterations = 1;
+	while (time(iterations) < min_sample_ns && iterations < (1ULL << 30)) {
+		iterations *= 2;
+	}
+
+	Samples samples;
+	double total = 0.0;
+	for (uint32_t s = 0; s < sample_count; ++s) {
+		double per_call = time(iterations) / double(iterations);
+		samples.add(per_call);
+		total += per_call;
+	}
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "%s\t%llu\t%llu\t%.1f\t%.1f\t%.1f",
+		name.c_str(), (unsigned long long)n, (unsigned long long)iterations,
+		samples.percentile(0.0), samples.percentile(0.5), total / double(sample_count));
+	std::cout << line << std::endl;
+}
+
+//------------ read_chunk ------------
+
+//a stream holding 'count' chunks of 'bytes' bytes each; reading from it:
+static void bench_read_chunk(std::string const &name, uint32_t count, uint32_t bytes) {
+	std::ostringstream blob;
+	std::vector< uint32_t > data(bytes / sizeof(uint32_t));
+	for (uint32_t i = 0; i < data.size(); ++i) {
+		data[i] = i * 0x9e3779b1U;
+	}
+	for (uint32_t c = 0; c < count; ++c) {
+		write_chunk("dat0", data, &blob);
+	}
+	std::istringstream from(blob.str());
+
+	std::vector< uint32_t > to;
+	measure(name, uint64_t(count) * bytes, [&]() {
+		from.clear();
+		from.seekg(0);
+		for (uint32_t c = 0; c < count; ++c) {
+			read_chunk(from, "dat0", &to);
+		}
+	});
+}
+
+//------------ MeshIndex::build ------------
+
+//the index chunks of a (quantized, indexed) blob with 'count' meshes, laid out like meshes.blob:
+struct SyntheticIndex {
+	std::string names;
+	std::vector< MeshIndex::Entry > entries;
+	std::vector< MeshIndex::IndexRange > ranges;
+	std::vector< uint16_t > indices;
+	std::vector< MeshIndex::Quantization > quantizations;
+	uint32_t vertex_count = 0;
+
+	SyntheticIndex(uint32_t count) {
+		Rng rng(count);
+		for (uint32_t m = 0; m < count; ++m) {
+			//(a cube's worth of vertices and triangles per mesh)
+			uint32_t const vertices = 24;
+			uint32_t const triangles = 12;
+
+			MeshIndex::Entry entry;
+			entry.name_begin = uint32_t(names.size());
+			names += "Mesh." + std::to_string(rng() % 100000) + "." + std::to_string(m);
+			entry.name_end = uint32_t(names.size());
+			entry.vertex_begin = vertex_count;
+			vertex_count += vertices;
+			entry.vertex_end = vertex_count;
+			entries.emplace_back(entry);
+
+			MeshIndex::IndexRange range;
+			range.index_begin = uint32_t(indices.size());
+			for (uint32_t i = 0; i < 3 * triangles; ++i) {
+				indices.emplace_back(uint16_t(rng() % vertices));
+			}
+			range.index_end = uint32_t(indices.size());
+			ranges.emplace_back(range);
+
+			MeshIndex::Quantization quantization;
+			quantization.scale = glm::vec3(1.0f / 32767.0f);
+			quantization.offset = glm::vec3(0.0f);
+			quantizations.emplace_back(quantization);
+		}
+	}
+};
+
+static void bench_mesh_index(uint32_t count) {
+	SyntheticIndex blob(count);
+	measure("MeshIndex::build", count, [&]() {
+		MeshIndex index;
+		index.build(
+			blob.names.data(), blob.names.size(),
+			blob.entries.data(), blob.entries.size(),
+			blob.vertex_count,
+			blob.ranges.data(), blob.indices.data(), blob.indices.size(),
+			blob.quantizations.data());
+	});
+
+	//...and looking up every mesh once:
+	MeshIndex index;
+	index.build(
+		blob.names.data(), blob.names.size(),
+		blob.entries.data(), blob.entries.size(),
+		blob.vertex_count,
+		blob.ranges.data(), blob.indices.data(), blob.indices.size(),
+		blob.quantizations.data());
+	std::vector< std::string > names;
+	for (auto const &entry : blob.entries) {
+		names.emplace_back(blob.names.substr(entry.name_begin, entry.name_end - entry.name_begin));
+	}
+	measure("MeshIndex::lookup(all)", count, [&]() {
+		for (auto const &name : names) {
+			index.lookup(name);
+		}
+	});
+}
+
+//------------ geese ------------
+
+//a game with 'count' geese scattered at roughly two per collision cell:
+// (at the game's own spawn density -- everyone on a 5x2.5 board -- collision cost is quadratic,
+//  which would swamp how the routines themselves scale)
+static void scatter_geese(GameState *state, uint32_t count) {
+	float side = std::sqrt(float(count) * state->min_r * state->min_r / 2.0f);
+	state->geese.clear();
+	for (uint32_t i = 0; i < count; ++i) {
+		state->geese.add(
+			side * float(state->rng() % 65536) / 65536.0f,
+			side * float(state->rng() % 65536) / 65536.0f
+		);
+	}
+}
+
+static void bench_geese(uint32_t count) {
+	float const elapsed = 1.0f / 120.0f;
+
+	GameState state(1);
+	scatter_geese(&state, count);
+	glm::vec2 duck = glm::vec2(-10.0f, 0.0f); //(off the board, so nobody is touching it)
+
+	//(a fraction of zero does the same work as a real chase without moving anyone, so every call is alike)
+	measure("Geese::chase", count, [&]() {
+		state.geese.chase(duck, 0.0f, elapsed, duck, glm::vec2(0.4f, 0.0f), state.min_r);
+	});
+
+	measure("geese_grid.build", count, [&]() {
+		state.geese_grid.build(state.min_r, state.geese.x.data(), state.geese.y.data(), state.geese.size());
+	});
+
+	state.geese_grid.build(state.min_r, state.geese.x.data(), state.geese.y.data(), state.geese.size());
+	measure("enemies_collision(all)", count, [&]() {
+		state.enemies_collision(elapsed);
+	});
+
+	//everything the geese do in one tick:
+	measure("GameState::update(geese)", count, [&]() {
+		state.update(0.0f);
+	});
+}
+
+//------------ targets ------------
+
+static void bench_targets(uint32_t count) {
+	GameState state(1);
+	state.start_targets = count;
+	state.start_geese = 0;
+	state.points_per_goose = 0; //(so hits don't add geese)
+	state.populate();
+
+	//a check that hits nothing:
+	state.duck_pos[3][0] = -10.0f;
+	state.height = 0.0f;
+	measure("check_targets(miss)", count, [&]() {
+		state.check_targets();
+	});
+
+	//...and one that hits (at least) one target, which is removed and respawned:
+	measure("check_targets(respawn)", count, [&]() {
+		state.duck_pos[3][0] = state.targets[0][3][0];
+		state.height = state.targets[0][3][1];
+		state.check_targets();
+	});
+}
+
+//------------ draw list ------------
+
+//queue and sort 'count' copies of meshes the way Game::draw does (a few passes and pipelines,
+// a dozen meshes, every copy with its own transform), then prepare them for drawing:
+static void bench_draw_list(uint32_t count) {
+	RenderQueue queue;
+
+	RenderQueue::Pipeline pipelines[2];
+	pipelines[0].program = 1;
+	pipelines[0].vao = 1;
+	pipelines[1].program = 2;
+	pipelines[1].vao = 2;
+
+	std::vector< Mesh > meshes(12);
+	for (uint32_t m = 0; m < meshes.size(); ++m) {
+		meshes[m].first = m * 24;
+		meshes[m].count = 24;
+		meshes[m].position_scale = glm::vec3(1.0f / 32767.0f);
+	}
+
+	struct Copy {
+		RenderQueue::Pass pass;
+		uint32_t pipeline;
+		uint32_t mesh;
+		glm::mat4 object_to_world;
+	};
+	std::vector< Copy > copies;
+	Rng rng(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		Copy copy;
+		copy.pass = RenderQueue::Pass(rng() % RenderQueue::PassCount);
+		copy.pipeline = rng() % 2;
+		copy.mesh = rng() % uint32_t(meshes.size());
+		float angle = float(rng() % 360) / 360.0f * 6.2831853f;
+		copy.object_to_world = glm::mat4(
+			std::cos(angle), std::sin(angle), 0.0f, 0.0f,
+			-std::sin(angle), std::cos(angle), 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			rng() % 100 / 20.0f, rng() % 100 / 28.0f, 0.0f, 1.0f);
+		copies.emplace_back(copy);
+	}
+
+	measure("RenderQueue::add+prepare", count, [&]() {
+		for (Copy const &copy : copies) {
+			queue.add(copy.pass, pipelines[copy.pipeline], meshes[copy.mesh], copy.object_to_world);
+		}
+		queue.prepare();
+		queue.items.clear();
+		queue.objects.clear();
+	});
+}
+
+int main(int argc, char **argv) {
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--quick") {
+			options.quick = true;
+		} else if (arg == "--help" || (!arg.empty() && arg[0] == '-')) {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--quick] [name ...]\n"
+				"Runs the benchmarks whose names contain any 'name' (or all of them) and prints their timings." << std::endl;
+			return (arg == "--help" ? 0 : 1);
+		} else {
+			options.filters.emplace_back(arg);
+		}
+	}
+
+	std::cout << "# bench\tn\titerations\tmin_ns\tmedian_ns\tmean_ns" << std::endl;
+
+	//one small chunk (like meshes.blob's names or index) many times, and one huge chunk:
+	bench_read_chunk("read_chunk(small)", 64, 256);
+	bench_read_chunk("read_chunk(huge)", 1, 64 << 20);
+
+	for (uint32_t count : {10, 100, 1000, 10000}) {
+		bench_mesh_index(count);
+	}
+
+	for (uint32_t count : {10, 100, 1000, 10000, 100000}) {
+		bench_geese(count);
+	}
+
+	for (uint32_t count : {10, 100, 1000, 10000, 100000}) {
+		bench_targets(count);
+	}
+
+	for (uint32_t count : {100, 1000, 10000, 100000}) {
+		bench_draw_list(count);
+	}
+
+	return 0;
+}
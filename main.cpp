@@ -1,5 +1,11 @@
 //Game.hpp declares the "game" object, which handles game-specific stuff:
 #include "Game.hpp"
+//Stress.hpp describes the scripted scenario run by --stress:
+#include "Stress.hpp"
+//Profiler.hpp times sections of code (PROFILE_SCOPE) for --profile:
+#include "Profiler.hpp"
+//Offscreen.hpp makes a windowless context for --offscreen:
+#include "Offscreen.hpp"
 
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
@@ -19,15 +25,337 @@
 #include <fstream>
 #include <memory>
 #include <algorithm>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <cmath>
 
 int main(int argc, char **argv) {
+	//(startup is timed from here; see report_first_frame below)
+	auto launch_time = std::chrono::high_resolution_clock::now();
 
 	struct {
 		//TODO: this is where you set the title and size of your game window
 		std::string title = "Jump Duck";
 		glm::uvec2 size = glm::uvec2(1280, 800);
+
+		//seed for the game's random number generator; picked at random unless given with --seed:
+		uint64_t seed = 0;
+		bool seed_given = false;
+
+		//simulation steps per second (see Game::update):
+		float tick_rate = 120.0f;
+
+		//write inputs to this file on exit (see Replay.hpp):
+		std::string record;
+		//...or play them back from this one (seed and tick rate come from the replay):
+		std::string replay;
+		//with a replay: just simulate it as fast as possible and print the final state's hash:
+		bool headless = false;
+
+		//run a scripted scenario with given populations and report timings (see Stress.hpp):
+		bool stress = false;
+		Stress stress_scenario;
+
+		//record PROFILE_SCOPE timings and write them to this file (on exit, or when F2 is pressed):
+		std::string profile;
+
+		//time each render pass on the GPU and print statistics every few seconds:
+		bool gpu_times = false;
+
+		//render 'frames' frames of 'size' without a window (or display), then report timings (see Offscreen.hpp):
+		bool offscreen = false;
+		uint32_t frames = 0; //(0: all of a --replay or --stress, or else 600)
+		//...and write the last frame to this image:
+		std::string screenshot;
 	} config;
 
+	//------------  command line ------------
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--seed" && argi + 1 < argc) {
+			try {
+				config.seed = std::stoull(argv[argi+1], nullptr, 0);
+			} catch (std::exception &) {
+				std::cerr << "Invalid seed '" << argv[argi+1] << "'." << std::endl;
+				return 1;
+			}
+			config.seed_given = true;
+			argi += 1;
+		} else if (arg == "--tick-rate" && argi + 1 < argc) {
+			try {
+				config.tick_rate = std::stof(argv[argi+1]);
+			} catch (std::exception &) {
+				config.tick_rate = 0.0f;
+			}
+			if (!(config.tick_rate >= 1.0f && config.tick_rate <= 10000.0f)) {
+				std::cerr << "Invalid tick rate '" << argv[argi+1] << "' (expecting steps per second, 1 to 10000)." << std::endl;
+				return 1;
+			}
+			argi += 1;
+		} else if (arg == "--record" && argi + 1 < argc) {
+			config.record = argv[argi+1];
+			argi += 1;
+		} else if (arg == "--replay" && argi + 1 < argc) {
+			config.replay = argv[argi+1];
+			argi += 1;
+		} else if (arg == "--profile" && argi + 1 < argc) {
+			config.profile = argv[argi+1];
+			argi += 1;
+		} else if (arg == "--gpu-times") {
+			config.gpu_times = true;
+		} else if (arg == "--headless") {
+			config.headless = true;
+		} else if (arg == "--offscreen") {
+			config.offscreen = true;
+			//(optionally followed by a size)
+			unsigned int w = 0, h = 0;
+			char extra = '\0';
+			if (argi + 1 < argc && std::sscanf(argv[argi+1], "%ux%u%c", &w, &h, &extra) == 2) {
+				if (w == 0 || h == 0 || w > 16384 || h > 16384) {
+					std::cerr << "Invalid offscreen size '" << argv[argi+1] << "'." << std::endl;
+					return 1;
+				}
+				config.size = glm::uvec2(w, h);
+				argi += 1;
+			}
+		} else if (arg == "--frames" && argi + 1 < argc) {
+			try {
+				config.frames = uint32_t(std::stoul(argv[argi+1]));
+			} catch (std::exception &) {
+				config.frames = 0;
+			}
+			if (config.frames == 0) {
+				std::cerr << "Invalid frame count '" << argv[argi+1] << "'." << std::endl;
+				return 1;
+			}
+			argi += 1;
+		} else if (arg == "--screenshot" && argi + 1 < argc) {
+			config.screenshot = argv[argi+1];
+			argi += 1;
+		} else if (arg == "--stress") {
+			config.stress = true;
+			//(followed by any number of key=value settings)
+			while (argi + 1 < argc && config.stress_scenario.parse(argv[argi+1])) {
+				argi += 1;
+			}
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--seed <number>] [--tick-rate <steps per second>] [--record <file>] [--profile <trace.json>] [--gpu-times]\n"
+			          << "\t" << argv[0] << " --replay <file> [--headless]\n"
+			          << "\t" << argv[0] << " --stress [eggs=<count>] [geese=<count>] [seconds=<time>] [density=<geese per cell>] [--seed <number>] [--tick-rate <steps per second>] [--headless]\n"
+			          << "\t  (geese spawn over a larger area once more than <density>, default 2, would share a collision cell;\n"
+			          << "\t   ticks grow with the square of the geese per cell, so packing 100k onto the board takes seconds per tick)\n"
+			          << "\t" << argv[0] << " --offscreen [<width>x<height>] [--frames <count>] [--screenshot <file.ppm>] [--gpu-times] [--replay <file> | --stress ...]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (config.headless && config.replay.empty() && !config.stress) {
+		std::cerr << "--headless needs a --replay or --stress to run." << std::endl;
+		return 1;
+	}
+	if (config.offscreen && config.headless) {
+		std::cerr << "--offscreen renders frames, so it can't be used with --headless." << std::endl;
+		return 1;
+	}
+	if ((config.frames || !config.screenshot.empty()) && !config.offscreen) {
+		std::cerr << "--frames and --screenshot only apply to --offscreen." << std::endl;
+		return 1;
+	}
+	if (config.stress && !config.replay.empty()) {
+		std::cerr << "--stress plays its own script, so it can't be used with --replay." << std::endl;
+		return 1;
+	}
+
+	Replay replay;
+	if (!config.replay.empty()) {
+		try {
+			replay.load(config.replay);
+		} catch (std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		config.seed = replay.header.seed;
+		config.seed_given = true;
+		config.tick_rate = replay.header.tick_rate;
+	}
+
+	//profiling starts before anything else, so asset loading is included:
+	auto write_profile = [&config]() {
+		try {
+			Profiler::write_trace(config.profile);
+			std::cout << "Wrote trace to '" << config.profile << "'." << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << e.what() << std::endl;
+		}
+	};
+	if (!config.profile.empty()) {
+		Profiler::set_thread_name("main");
+		Profiler::enable(true);
+	}
+
+	Stress const &stress = config.stress_scenario;
+	if (config.stress) {
+		//(stress runs use a fixed seed unless told otherwise, so they are comparable)
+		config.seed_given = true;
+		replay = stress.script(config.seed, config.tick_rate);
+		std::cout << "Stress: " << stress.eggs << " eggs, " << stress.geese << " geese (at most " << stress.density << " per cell), "
+		          << stress.seconds << " s at " << config.tick_rate << " Hz." << std::endl;
+	}
+
+	if (config.headless) {
+		//no window, no GL, no vsync -- just the simulation:
+		GameState state(replay.header.seed);
+		Samples tick_ms;
+		auto before = std::chrono::high_resolution_clock::now();
+		if (config.stress) {
+			//(same as Replay::play, but timing every step)
+			stress.populate(&state);
+			float tick = 1.0f / replay.header.tick_rate;
+			size_t next = 0;
+			for (uint64_t t = 0; t < replay.header.ticks; ++t) {
+				replay.apply(t, &next, &state);
+				auto step_before = std::chrono::high_resolution_clock::now();
+				state.update(tick);
+				auto step_after = std::chrono::high_resolution_clock::now();
+				tick_ms.add(std::chrono::duration< double, std::milli >(step_after - step_before).count());
+			}
+		} else {
+			replay.play(&state);
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration< double, std::milli >(after - before).count();
+
+		std::cout << "Replayed " << replay.header.ticks << " steps (" << double(replay.header.ticks) / replay.header.tick_rate
+		          << " s of play at " << replay.header.tick_rate << " Hz) in " << ms << " ms." << std::endl;
+		if (config.stress) {
+			tick_ms.report(std::cout, "tick");
+		}
+		char hash[17];
+		std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)state.hash());
+		std::cout << "Final state hash: " << hash << std::endl;
+		if (!config.profile.empty()) write_profile();
+		return 0;
+	}
+
+	if (config.offscreen) {
+		//(like stress runs, offscreen runs use a fixed seed unless told otherwise, so their frames are comparable)
+		config.seed_given = true;
+	}
+	if (!config.seed_given) {
+		std::random_device rd;
+		config.seed = (uint64_t(rd()) << 32) | uint64_t(rd());
+	}
+	//(printed so that any game can be played again with --seed)
+	std::cout << "Seed: " << config.seed << std::endl;
+
+	//clear the depth+color buffers and set some default state:
+	auto begin_draw = []() {
+		glClearColor(0.5, 0.5, 0.5, 0.0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	};
+
+	//print how long it took to get the first frame of the game (not just a cleared frame) out:
+	// (meshes load on a background thread meanwhile; see MeshLoader.hpp)
+	auto report_first_frame = [launch_time](Game const &game) {
+		double ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - launch_time).count();
+		std::cout << "Time to first frame: " << ms << " ms (meshes loaded in " << game.mesh_loader->load_ms << " ms on the loader thread)." << std::endl;
+	};
+
+	if (config.offscreen) {
+		//no window: draw into a framebuffer, as fast as possible, with time advancing a fixed
+		// 1/60 s per frame (so the same arguments always draw the same frames):
+		std::unique_ptr< Offscreen > offscreen;
+		try {
+			offscreen.reset(new Offscreen(config.size));
+		} catch (std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		//(SDL didn't make this context, so it can't look up extension functions in it)
+		RingBuffer::get_proc_address = Offscreen::get_proc_address;
+
+		float const elapsed = 1.0f / 60.0f;
+		uint32_t frames = config.frames;
+		if (frames == 0) {
+			frames = (!config.replay.empty() || config.stress ? uint32_t(std::ceil(replay.header.ticks / replay.header.tick_rate / elapsed)) : 600);
+		}
+		std::cout << "Offscreen: " << frames << " frames at " << config.size.x << "x" << config.size.y
+		          << " (" << offscreen->description() << ")." << std::endl;
+
+		Samples update_ms; //per call to Game::update
+		Samples draw_ms; //per call to Game::draw (CPU time to queue and submit draws)
+		Samples frame_ms; //per frame, including waiting for the GPU to finish it
+		std::vector< glm::u8vec4 > pixels;
+		{ //(the game's GL objects must go before the context does)
+			Game game(config.seed);
+			game.tick_rate = config.tick_rate;
+			if (config.stress) {
+				stress.populate(&game.state);
+			}
+			if (!config.replay.empty() || config.stress) {
+				game.play(&replay);
+			}
+			game.gpu_timers.enabled = config.gpu_times;
+			//(every frame is drawn, so the same arguments always draw the same frames)
+			game.wait_for_meshes();
+
+			for (uint32_t frame = 0; frame < frames; ++frame) {
+				PROFILE_SCOPE("frame");
+				auto before = std::chrono::high_resolution_clock::now();
+				{
+					PROFILE_SCOPE("update");
+					game.update(elapsed);
+				}
+				auto after_update = std::chrono::high_resolution_clock::now();
+				{
+					PROFILE_SCOPE("draw");
+					game.gpu_timers.begin_frame();
+					begin_draw();
+					game.draw(config.size);
+				}
+				auto after_draw = std::chrono::high_resolution_clock::now();
+				game.gpu_timers.end_frame();
+				{
+					//(there is no swap to wait on, so wait for the frame itself)
+					PROFILE_SCOPE("finish");
+					glFinish();
+				}
+				auto after = std::chrono::high_resolution_clock::now();
+				update_ms.add(std::chrono::duration< double, std::milli >(after_update - before).count());
+				draw_ms.add(std::chrono::duration< double, std::milli >(after_draw - after_update).count());
+				frame_ms.add(std::chrono::duration< double, std::milli >(after - before).count());
+				if (frame == 0) report_first_frame(game);
+			}
+
+			update_ms.report(std::cout, "update");
+			draw_ms.report(std::cout, "draw submission");
+			frame_ms.report(std::cout, "frame");
+			if (config.gpu_times) game.gpu_timers.report(std::cout);
+
+			pixels = offscreen->read_pixels();
+		}
+
+		char hash[17];
+		std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)Offscreen::hash(pixels));
+		std::cout << "Final frame hash: " << hash << std::endl;
+		if (!config.screenshot.empty()) {
+			try {
+				Offscreen::save_ppm(config.screenshot, config.size, pixels);
+				std::cout << "Wrote final frame to '" << config.screenshot << "'." << std::endl;
+			} catch (std::exception &e) {
+				std::cerr << e.what() << std::endl;
+				return 1;
+			}
+		}
+		if (!config.profile.empty()) write_profile();
+		return 0;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -78,7 +406,12 @@ int main(int argc, char **argv) {
 #endif
 
 	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (SDL_GL_SetSwapInterval(-1) != 0) {
+	// (except for stress runs, which measure how fast frames can go)
+	if (config.stress) {
+		if (SDL_GL_SetSwapInterval(0) != 0) {
+			std::cerr << "NOTE: couldn't turn off vsync (" << SDL_GetError() << "); frame times will include it." << std::endl;
+		}
+	} else if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
 		if (SDL_GL_SetSwapInterval(1) != 0) {
 			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
@@ -88,10 +421,29 @@ int main(int argc, char **argv) {
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
+	//Show a cleared frame right away, rather than an empty window, while the game starts:
+	begin_draw();
+	SDL_GL_SwapWindow(window);
+	std::cout << "Window shown after " << std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - launch_time).count() << " ms." << std::endl;
+
 
-	//------------ create game object (loads assets) --------------
+	//------------ create game object (starts loading assets) --------------
+
+	std::shared_ptr< Game > game = std::make_shared< Game >(config.seed);
+	game->tick_rate = config.tick_rate;
+	if (config.stress) {
+		stress.populate(&game->state);
+	}
+	game->gpu_timers.enabled = config.gpu_times;
+	auto gpu_report_time = std::chrono::high_resolution_clock::now();
+	if (!config.replay.empty() || config.stress) {
+		game->play(&replay);
+	}
 
-	std::shared_ptr< Game > game = std::make_shared< Game >();
+	//timings collected during --stress (in milliseconds):
+	Samples tick_ms; //per simulation step (averaged over the steps of each update)
+	Samples draw_ms; //per call to Game::draw (CPU time to queue and submit draws)
+	Samples frame_ms; //per pass through the main loop
 
 	//------------ main loop ------------
 
@@ -110,24 +462,40 @@ int main(int argc, char **argv) {
 		glViewport(0, 0, drawable_size.x, drawable_size.y);
 	};
 	on_resize();
+	bool first_frame_reported = false;
 	
 	//This will loop until the game object is set to null:
 	while (game) {
+		PROFILE_SCOPE("frame");
+		auto frame_before = std::chrono::high_resolution_clock::now();
 
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
 		{ //(1) process any events that are pending
+			PROFILE_SCOPE("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
 				if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
 					on_resize();
 				}
+				//F2 writes the trace so far (when profiling):
+				if (!config.profile.empty() && evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_F2 && !evt.key.repeat) {
+					write_profile();
+				}
 				//handle input:
 				if (game && game->handle_event(evt, window_size)) {
 					// mode handled it; great
 				} else if (evt.type == SDL_QUIT) {
+					if (!config.record.empty() && !game->playback) {
+						try {
+							game->save_recording(config.record);
+							std::cout << "Wrote replay of " << game->ticks << " steps to '" << config.record << "'." << std::endl;
+						} catch (std::exception &e) {
+							std::cerr << e.what() << std::endl;
+						}
+					}
 					game.reset(); //done: deallocate game
 					break;
 				}
@@ -136,35 +504,76 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(2) call the game's "update" function to deal with elapsed time:
+			PROFILE_SCOPE("update");
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
 			previous_time = current_time;
 
-			//if frames are taking a very long time to process,
-			//lag to avoid spiral of death:
-			elapsed = std::min(0.1f, elapsed);
-
+			//(Game::update runs the simulation in fixed steps, and caps how far it will
+			// catch up if frames take a very long time, to avoid a spiral of death)
+			uint64_t ticks_before = game->ticks;
 			game->update(elapsed);
 			if (!game) break;
+			if (config.stress && game->ticks > ticks_before) {
+				//(just the simulation steps, as Game::update timed them -- not mesh uploads or interpolation snapshots)
+				tick_ms.add(game->perf_hud.tick_ms);
+			}
 		}
 
 		{ //(3) call the game's "draw" function to produce output:
-			//clear the depth+color buffers and set some default state:
-			glClearColor(0.5, 0.5, 0.5, 0.0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			PROFILE_SCOPE("draw");
+			game->gpu_timers.begin_frame();
+			begin_draw();
 
+			auto draw_before = std::chrono::high_resolution_clock::now();
 			game->draw(drawable_size);
+			if (config.stress) {
+				auto after = std::chrono::high_resolution_clock::now();
+				draw_ms.add(std::chrono::duration< double, std::milli >(after - draw_before).count());
+			}
+			game->gpu_timers.end_frame();
+
+			if (config.gpu_times) {
+				auto now = std::chrono::high_resolution_clock::now();
+				if (now - gpu_report_time > std::chrono::seconds(2)) {
+					gpu_report_time = now;
+					game->gpu_timers.report(std::cout);
+				}
+			}
 		}
 
 		//Finally, wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		{
+			PROFILE_SCOPE("swap");
+			SDL_GL_SwapWindow(window);
+		}
+		//(until meshes are ready, update and draw do nothing, so frames are just cleared)
+		if (!first_frame_reported && game->meshes_ready) {
+			report_first_frame(*game);
+			first_frame_reported = true;
+		}
+
+		if (config.stress) {
+			auto after = std::chrono::high_resolution_clock::now();
+			frame_ms.add(std::chrono::duration< double, std::milli >(after - frame_before).count());
+			if (game->ticks >= replay.header.ticks) { //scenario over
+				if (config.gpu_times) game->gpu_timers.report(std::cout);
+				game.reset();
+				break;
+			}
+		}
+	}
+
+	if (config.stress) {
+		tick_ms.report(std::cout, "tick");
+		draw_ms.report(std::cout, "draw submission");
+		frame_ms.report(std::cout, "frame");
 	}
 	//------------  teardown ------------
 
+	if (!config.profile.empty()) write_profile();
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
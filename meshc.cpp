@@ -0,0 +1,826 @@
+//meshc compiles the COLLADA (.dae) files in meshes/ into dist/meshes.blob, without Blender:
+//   jam meshc && dist/meshc [--jobs N] [--incremental] [--float] [--no-optimize] [--no-lods] meshes/meshes.list dist/meshes.blob
+//
+//The manifest (meshes/meshes.list) names each mesh in the blob and where it comes from:
+//   <name>: <file.dae> [geometry <id>] [axes <a> <b> <c>] [scale <s> | <sx> <sy> <sz>] [offset <x> <y> <z>]
+//   <name>: keep
+//Files are relative to the manifest (quote names with spaces). The .dae files hold meshes in their
+// own coordinates, so 'axes', 'scale', and 'offset' place a mesh the way the game expects it:
+// output coordinate i is scale[i] * (axis a_i of the file, e.g. "-y") + offset[i].
+//'keep' copies a mesh that has no source file from the existing output blob (converting its vertex
+// format if need be).
+//
+//Each .dae file is parsed and compiled by one of '--jobs' worker threads (default: one per core).
+//The blob is written the way export-meshes.py writes it -- quantized, indexed vertices
+// (dat1 str0 idx0 ix16 ixr0 qnt0 lod0), or float vertices (vtx0 str0 idx0 ix16 ixr0 lod0) with --float --
+// after a table of contents ("toc1"; see MappedBlob.hpp), to a temporary file that replaces the output
+// when complete.
+//
+//Unless --no-optimize is given, every mesh (including kept ones) is reordered for the GPU's vertex cache
+// and to reduce overdraw (see MeshOptimizer.hpp), and its cache miss ratios before and after are
+// reported.
+//Unless --no-lods is given, every mesh also gets up to Mesh::MaxLods simplified levels of detail (about
+// 1/2, 1/4, and 1/8 of its triangles; see simplify() in MeshOptimizer.hpp), stored as extra index
+// ranges over the same vertices ("lod0"). Levels that don't remove enough triangles are left out.
+//Both passes can be run on any existing blob (keeping its vertex format):
+//   dist/meshc --optimize dist/meshes.blob dist/meshes.blob
+//
+//With --incremental, meshes whose source file and manifest line haven't changed since the last
+// run are copied from the existing output instead of being compiled again; the hashes that
+// decide this are kept next to the output (in <out.blob>.sources).
+
+#include "Collada.hpp"
+#include "MeshIndex.hpp" //blob records
+#include "MeshOptimizer.hpp"
+#include "MappedBlob.hpp"
+#include "write_chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+//one line of the manifest:
+struct Source {
+	std::string name; //name of the mesh in the blob
+	bool keep = false; //copy from the existing output instead of compiling
+	std::string file; //path to the .dae file
+	std::string geometry; //id of the geometry in 'file' (if empty, the file must have exactly one)
+	glm::mat3 transform = glm::mat3(1.0f); //applied to positions, then...
+	glm::vec3 offset = glm::vec3(0.0f); //...added
+	std::string spec; //everything after "<name>:", for noticing changes
+};
+
+//a compiled mesh, as it will be stored:
+struct Compiled {
+	std::vector< uint8_t > vertices; //MeshIndex::PackedVertex or MeshIndex::Vertex records
+	std::vector< uint16_t > indices; //relative to the first vertex
+	MeshIndex::Quantization quantization; //(quantized only)
+	uint64_t hash = 0; //of the source (for --incremental)
+	enum { Built, Reused, Kept } how = Built;
+	bool optimized = false; //(by this run)
+	CacheStats before, after; //(if optimized)
+	struct Lod {
+		std::vector< uint16_t > indices; //(over the same vertices as 'indices')
+		float error = 0.0f; //object-space distance from the full mesh
+	};
+	std::vector< Lod > lods; //finest to coarsest
+	std::string error; //if compiling failed
+};
+
+//FNV-1a, as used for frame hashes elsewhere:
+static uint64_t hash_bytes(uint64_t h, void const *data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		h = (h ^ static_cast< uint8_t const * >(data)[i]) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+//------------ manifest ------------
+
+//split a manifest line into words (double quotes group words with spaces):
+static std::vector< std::string > split_words(std::string const &line, std::string const &where) {
+	std::vector< std::string > words;
+	for (size_t at = 0; at < line.size(); ) {
+		if (std::isspace(uint8_t(line[at]))) {
+			++at;
+		} else if (line[at] == '"') {
+			size_t end = line.find('"', at + 1);
+			if (end == std::string::npos) throw std::runtime_error(where + ": unterminated quote.");
+			words.emplace_back(line.substr(at + 1, end - at - 1));
+			at = end + 1;
+		} else {
+			size_t end = at;
+			while (end < line.size() && !std::isspace(uint8_t(line[end]))) ++end;
+			words.emplace_back(line.substr(at, end - at));
+			at = end;
+		}
+	}
+	return words;
+}
+
+static float parse_float(std::string const &word, std::string const &where) {
+	char *end = nullptr;
+	float value = std::strtof(word.c_str(), &end);
+	if (word.empty() || *end != '\0') throw std::runtime_error(where + ": expected a number, got '" + word + "'.");
+	return value;
+}
+
+static std::vector< Source > load_manifest(std::string const &filename) {
+	std::ifstream file(filename);
+	if (!file) {
+		throw std::runtime_error("Failed to open manifest '" + filename + "'.");
+	}
+	//files are relative to the manifest:
+	std::string base;
+	size_t slash = filename.find_last_of("/\\");
+	if (slash != std::string::npos) base = filename.substr(0, slash + 1);
+
+	std::vector< Source > sources;
+	std::string line;
+	for (uint32_t line_number = 1; std::getline(file, line); ++line_number) {
+		std::string where = filename + ":" + std::to_string(line_number);
+		size_t first = line.find_first_not_of(" \t\r");
+		if (first == std::string::npos || line[first] == '#') continue; //(blank lines and comments)
+
+		size_t colon = line.find(':');
+		if (colon == std::string::npos) throw std::runtime_error(where + ": expected '<name>: <file.dae> ...' or '<name>: keep'.");
+		Source source;
+		source.name = line.substr(0, colon);
+		source.name.erase(0, source.name.find_first_not_of(" \t"));
+		source.name.erase(source.name.find_last_not_of(" \t") + 1);
+		if (source.name.empty()) throw std::runtime_error(where + ": missing mesh name.");
+		source.spec = line.substr(colon + 1);
+
+		std::vector< std::string > words = split_words(source.spec, where);
+		if (words.empty()) throw std::runtime_error(where + ": missing file for '" + source.name + "'.");
+		if (words.size() == 1 && words[0] == "keep") {
+			source.keep = true;
+			sources.emplace_back(source);
+			continue;
+		}
+		source.file = base + words[0];
+
+		glm::ivec3 axes = glm::ivec3(0, 1, 2);
+		glm::vec3 signs = glm::vec3(1.0f);
+		glm::vec3 scale = glm::vec3(1.0f);
+		for (size_t w = 1; w < words.size(); ) {
+			std::string const &key = words[w++];
+			auto numbers = [&]() -> size_t { //count of numbers following 'key'
+				size_t n = 0;
+				while (w + n < words.size() && words[w + n].find_first_not_of("+-.0123456789eE") == std::string::npos) ++n;
+				return n;
+			};
+			if (key == "geometry" && w < words.size()) {
+				source.geometry = words[w++];
+			} else if (key == "axes" && w + 3 <= words.size()) {
+				for (uint32_t i = 0; i < 3; ++i) {
+					std::string axis = words[w++];
+					signs[i] = 1.0f;
+					if (!axis.empty() && (axis[0] == '-' || axis[0] == '+')) {
+						signs[i] = (axis[0] == '-' ? -1.0f : 1.0f);
+						axis = axis.substr(1);
+					}
+					if (axis == "x") axes[i] = 0;
+					else if (axis == "y") axes[i] = 1;
+					else if (axis == "z") axes[i] = 2;
+					else throw std::runtime_error(where + ": expected an axis (x, y, z, -x, ...), got '" + axis + "'.");
+				}
+				if (axes[0] == axes[1] || axes[1] == axes[2] || axes[0] == axes[2]) {
+					throw std::runtime_error(where + ": 'axes' should name each axis once.");
+				}
+			} else if (key == "scale" && (numbers() == 1 || numbers() >= 3)) {
+				if (numbers() == 1) {
+					scale = glm::vec3(parse_float(words[w++], where));
+				} else {
+					for (uint32_t i = 0; i < 3; ++i) scale[i] = parse_float(words[w++], where);
+				}
+			} else if (key == "offset" && numbers() >= 3) {
+				for (uint32_t i = 0; i < 3; ++i) source.offset[i] = parse_float(words[w++], where);
+			} else {
+				throw std::runtime_error(where + ": didn't understand '" + key + "' (or its arguments).");
+			}
+		}
+
+		//output[i] = signs[i] * scale[i] * input[axes[i]] + offset[i]:
+		source.transform = glm::mat3(0.0f);
+		for (uint32_t i = 0; i < 3; ++i) {
+			source.transform[axes[i]][i] = signs[i] * scale[i];
+		}
+		sources.emplace_back(source);
+	}
+
+	std::sort(sources.begin(), sources.end(), [](Source const &a, Source const &b) {
+		return a.name < b.name;
+	});
+	for (size_t i = 1; i < sources.size(); ++i) {
+		if (sources[i-1].name == sources[i].name) {
+			throw std::runtime_error(filename + ": mesh '" + sources[i].name + "' is listed twice.");
+		}
+	}
+	return sources;
+}
+
+//------------ compiling ------------
+
+//octahedral normal encoding, as two values in [-127,127] (matches export-meshes.py and Game's vertex shader):
+static void oct_encode(glm::vec3 const &n, int8_t *out) {
+	double l1 = std::abs(double(n.x)) + std::abs(double(n.y)) + std::abs(double(n.z));
+	if (l1 == 0.0) {
+		out[0] = out[1] = 0;
+		return;
+	}
+	double x = n.x / l1;
+	double y = n.y / l1;
+	if (n.z < 0.0f) {
+		double fx = (1.0 - std::abs(y)) * (x >= 0.0 ? 1.0 : -1.0);
+		double fy = (1.0 - std::abs(x)) * (y >= 0.0 ? 1.0 : -1.0);
+		x = fx;
+		y = fy;
+	}
+	out[0] = int8_t(std::nearbyint(std::max(-1.0, std::min(1.0, x)) * 127.0));
+	out[1] = int8_t(std::nearbyint(std::max(-1.0, std::min(1.0, y)) * 127.0));
+}
+
+//encode and deduplicate triangle corners (three per triangle) into 'out':
+static void encode(std::vector< Collada::Corner > const &corners, bool quantize, std::string const &what, Compiled *_out);
+
+//place, encode, and deduplicate the triangles of one source:
+static void compile(Source const &source, std::string const &text, bool quantize, Compiled *_out) {
+	Collada dae(text, source.file);
+	std::vector< Collada::Corner > corners = dae.lookup(source.geometry).corners;
+
+	//place corners; normals transform by the inverse transpose, and mirroring flips winding:
+	glm::mat3 normal_transform = glm::inverse(glm::transpose(source.transform));
+	for (auto &c : corners) {
+		c.position = source.transform * c.position + source.offset;
+		glm::vec3 n = normal_transform * c.normal;
+		float length = glm::length(n);
+		c.normal = (length > 0.0f ? n / length : n);
+	}
+	if (glm::determinant(source.transform) < 0.0f) {
+		for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+			std::swap(corners[i+1], corners[i+2]);
+		}
+	}
+
+	encode(corners, quantize, source.file + ": mesh '" + source.name + "'", _out);
+}
+
+static void encode(std::vector< Collada::Corner > const &corners, bool quantize, std::string const &what, Compiled *_out) {
+	Compiled &out = *_out;
+
+	//encode each corner:
+	size_t const vertex_size = (quantize ? sizeof(MeshIndex::PackedVertex) : sizeof(MeshIndex::Vertex));
+	std::vector< uint8_t > encoded(corners.size() * vertex_size);
+	if (quantize) {
+		//positions span [-32767,32767] over the mesh's bounds (computed in double, like the export script):
+		glm::dvec3 lo = glm::dvec3(0.0), hi = glm::dvec3(0.0);
+		for (size_t i = 0; i < corners.size(); ++i) {
+			glm::dvec3 p = glm::dvec3(corners[i].position);
+			lo = (i == 0 ? p : glm::min(lo, p));
+			hi = (i == 0 ? p : glm::max(hi, p));
+		}
+		glm::dvec3 offset = 0.5 * (lo + hi);
+		glm::dvec3 scale = 0.5 * (hi - lo) / 32767.0;
+		out.quantization.scale = glm::vec3(scale);
+		out.quantization.offset = glm::vec3(offset);
+
+		for (size_t i = 0; i < corners.size(); ++i) {
+			MeshIndex::PackedVertex v;
+			for (uint32_t c = 0; c < 3; ++c) {
+				double q = (scale[c] > 0.0 ? std::nearbyint((double(corners[i].position[c]) - offset[c]) / scale[c]) : 0.0);
+				v.Position[c] = int16_t(std::max(-32767.0, std::min(32767.0, q)));
+			}
+			oct_encode(corners[i].normal, v.Normal);
+			v.Color = corners[i].color;
+			std::memcpy(&encoded[i * vertex_size], &v, vertex_size);
+		}
+	} else {
+		for (size_t i = 0; i < corners.size(); ++i) {
+			MeshIndex::Vertex v;
+			v.Position = corners[i].position;
+			v.Normal = corners[i].normal;
+			v.Color = corners[i].color;
+			std::memcpy(&encoded[i * vertex_size], &v, vertex_size);
+		}
+	}
+
+	//share identical vertices between triangles:
+	std::unordered_map< std::string, uint16_t > lookup;
+	out.vertices.clear();
+	out.indices.clear();
+	out.indices.reserve(corners.size());
+	for (size_t i = 0; i < corners.size(); ++i) {
+		std::string key(reinterpret_cast< char const * >(&encoded[i * vertex_size]), vertex_size);
+		auto f = lookup.find(key);
+		if (f == lookup.end()) {
+			size_t index = out.vertices.size() / vertex_size;
+			if (index > 0xffff) {
+				throw std::runtime_error(what + " has more than 65536 distinct vertices (indices are 16-bit).");
+			}
+			f = lookup.insert(std::make_pair(key, uint16_t(index))).first;
+			out.vertices.insert(out.vertices.end(), key.begin(), key.end());
+		}
+		out.indices.emplace_back(f->second);
+	}
+}
+
+//position of vertex 'i' of a mesh encoded by encode():
+static glm::vec3 vertex_position(Compiled const &mesh, bool quantized, uint32_t i) {
+	if (quantized) {
+		MeshIndex::PackedVertex v;
+		std::memcpy(&v, &mesh.vertices[i * sizeof(v)], sizeof(v));
+		return mesh.quantization.offset + mesh.quantization.scale * glm::vec3(v.Position[0], v.Position[1], v.Position[2]);
+	} else {
+		MeshIndex::Vertex v;
+		std::memcpy(&v, &mesh.vertices[i * sizeof(v)], sizeof(v));
+		return v.Position;
+	}
+}
+
+//vertex 'i' of a mesh encoded by encode(), decoded:
+static Collada::Corner vertex_corner(Compiled const &mesh, bool quantized, uint32_t i) {
+	Collada::Corner c;
+	c.position = vertex_position(mesh, quantized, i);
+	if (quantized) {
+		MeshIndex::PackedVertex v;
+		std::memcpy(&v, &mesh.vertices[i * sizeof(v)], sizeof(v));
+		//(as in Game's vertex shader)
+		glm::vec2 e = glm::vec2(v.Normal[0], v.Normal[1]) / 127.0f;
+		c.normal = glm::vec3(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+		if (c.normal.z < 0.0f) {
+			c.normal.x = (1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+			c.normal.y = (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		c.normal = glm::normalize(c.normal);
+		c.color = v.Color;
+	} else {
+		MeshIndex::Vertex v;
+		std::memcpy(&v, &mesh.vertices[i * sizeof(v)], sizeof(v));
+		c.normal = v.Normal;
+		c.color = v.Color;
+	}
+	return c;
+}
+
+//the triangle corners of a mesh encoded by encode(), for re-encoding in the other vertex format:
+static std::vector< Collada::Corner > decode(Compiled const &mesh, bool quantized) {
+	std::vector< Collada::Corner > corners;
+	corners.reserve(mesh.indices.size());
+	for (uint16_t i : mesh.indices) {
+		corners.emplace_back(vertex_corner(mesh, quantized, i));
+	}
+	return corners;
+}
+
+//reorder a mesh's triangles and vertices for drawing (see MeshOptimizer.hpp):
+static void optimize(Compiled *_mesh, bool quantized) {
+	Compiled &mesh = *_mesh;
+	size_t const vertex_size = (quantized ? sizeof(MeshIndex::PackedVertex) : sizeof(MeshIndex::Vertex));
+	uint32_t const vertex_count = uint32_t(mesh.vertices.size() / vertex_size);
+
+	std::vector< glm::vec3 > positions(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		positions[v] = vertex_position(mesh, quantized, v);
+	}
+
+	mesh.before = simulate_vertex_cache(mesh.indices, vertex_count);
+	std::vector< uint16_t > cache_order = mesh.indices;
+	optimize_vertex_cache(&cache_order, vertex_count);
+	std::vector< uint16_t > overdraw_order = cache_order;
+	optimize_overdraw(&overdraw_order, positions);
+	//never leave the mesh less cache-friendly than it was (splitting meshes that were already in good
+	// order -- like long strips -- into patches can cost more misses than it saves):
+	if (simulate_vertex_cache(overdraw_order, vertex_count).misses <= mesh.before.misses) {
+		mesh.indices = overdraw_order;
+	} else if (simulate_vertex_cache(cache_order, vertex_count).misses <= mesh.before.misses) {
+		mesh.indices = cache_order;
+	}
+	std::vector< uint32_t > remap = optimize_vertex_fetch(&mesh.indices, vertex_count);
+
+	std::vector< uint8_t > vertices(mesh.vertices.size());
+	uint32_t used = 0;
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		if (remap[v] == -1U) continue;
+		std::memcpy(&vertices[remap[v] * vertex_size], &mesh.vertices[v * vertex_size], vertex_size);
+		used += 1;
+	}
+	vertices.resize(used * vertex_size);
+	mesh.vertices = vertices;
+
+	mesh.after = simulate_vertex_cache(mesh.indices, used);
+	mesh.optimized = true;
+}
+
+//replace a mesh's levels of detail with simplified versions of its triangles (see simplify() in MeshOptimizer.hpp):
+static void make_lods(Compiled *_mesh, bool quantized) {
+	Compiled &mesh = *_mesh;
+	mesh.lods.clear();
+	size_t const vertex_size = (quantized ? sizeof(MeshIndex::PackedVertex) : sizeof(MeshIndex::Vertex));
+	uint32_t const vertex_count = uint32_t(mesh.vertices.size() / vertex_size);
+	if (vertex_count == 0) return;
+
+	std::vector< glm::vec3 > positions(vertex_count), normals(vertex_count);
+	std::vector< glm::u8vec4 > colors(vertex_count);
+	glm::vec3 lo = glm::vec3(0.0f), hi = glm::vec3(0.0f);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		Collada::Corner c = vertex_corner(mesh, quantized, v);
+		positions[v] = c.position;
+		normals[v] = c.normal;
+		colors[v] = c.color;
+		lo = (v == 0 ? c.position : glm::min(lo, c.position));
+		hi = (v == 0 ? c.position : glm::max(hi, c.position));
+	}
+	//(levels that move the surface further than this are too crude to be worth drawing)
+	float const max_error = 0.05f * glm::length(hi - lo);
+
+	size_t coarsest = mesh.indices.size();
+	float error = 0.0f;
+	for (uint32_t level = 1; level <= Mesh::MaxLods; ++level) {
+		size_t target = (mesh.indices.size() / 3 >> level) * 3;
+		Compiled::Lod lod;
+		lod.indices = simplify(mesh.indices, positions, normals, colors, target, max_error, &lod.error);
+		//only keep levels that draw noticeably fewer triangles than the last:
+		if (lod.indices.empty() || lod.indices.size() * 5 > coarsest * 4) break;
+		coarsest = lod.indices.size();
+		//(each level is simplified from the full mesh, so keep errors increasing along with coarseness)
+		error = lod.error = std::max(error, lod.error);
+		//coarse levels are drawn small, so only the vertex cache (not overdraw) is worth optimizing for:
+		std::vector< uint16_t > cache_order = lod.indices;
+		optimize_vertex_cache(&cache_order, vertex_count);
+		if (simulate_vertex_cache(cache_order, vertex_count).misses <= simulate_vertex_cache(lod.indices, vertex_count).misses) {
+			lod.indices = cache_order;
+		}
+		mesh.lods.emplace_back(lod);
+	}
+}
+
+//------------ existing output ------------
+
+//meshes of a blob written earlier (by meshc or export-meshes.py):
+struct Existing {
+	bool quantized = false;
+	std::vector< std::string > names; //in blob order
+	std::map< std::string, Compiled > meshes;
+	std::map< std::string, uint64_t > hashes; //from <blob>.sources
+};
+
+//read 'filename' (and its .sources) if they exist; throws if the blob exists but is malformed:
+static void load_existing(std::string const &filename, Existing *_existing) {
+	Existing &existing = *_existing;
+	if (!std::ifstream(filename)) return;
+
+	MappedBlob blob(filename);
+	existing.quantized = blob.has_chunk("dat1");
+	bool indexed = blob.has_chunk("ix16");
+	size_t const vertex_size = (existing.quantized ? sizeof(MeshIndex::PackedVertex) : sizeof(MeshIndex::Vertex));
+	MappedBlob::ChunkView< uint8_t > vertices = blob.read_chunk< uint8_t >(existing.quantized ? "dat1" : (indexed ? "vtx0" : "dat0"));
+	MappedBlob::ChunkView< char > names = blob.read_chunk< char >("str0");
+	MappedBlob::ChunkView< MeshIndex::Entry > entries = blob.read_chunk< MeshIndex::Entry >("idx0");
+	MappedBlob::ChunkView< uint16_t > indices;
+	MappedBlob::ChunkView< MeshIndex::IndexRange > ranges;
+	if (indexed) {
+		indices = blob.read_chunk< uint16_t >("ix16");
+		ranges = blob.read_chunk< MeshIndex::IndexRange >("ixr0");
+	}
+	MappedBlob::ChunkView< MeshIndex::Quantization > quantizations;
+	if (existing.quantized) {
+		quantizations = blob.read_chunk< MeshIndex::Quantization >("qnt0");
+	}
+	MappedBlob::ChunkView< MeshIndex::Lod > lods;
+	if (indexed && blob.has_chunk("lod0")) {
+		lods = blob.read_chunk< MeshIndex::Lod >("lod0");
+	}
+
+	//(MeshIndex::build checks every range)
+	MeshIndex index;
+	index.build(
+		static_cast< char const * >(names.data()), names.size(),
+		entries.data(), entries.size(),
+		vertices.size() / vertex_size,
+		ranges.data(), indices.data(), indices.size(),
+		quantizations.data(),
+		lods.data(), lods.size());
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+		MeshIndex::Entry entry = entries[i];
+		std::string name(static_cast< char const * >(names.data()) + entry.name_begin, static_cast< char const * >(names.data()) + entry.name_end);
+		Mesh const &mesh = index.lookup(name);
+		Compiled &compiled = existing.meshes[name];
+		compiled.how = Compiled::Reused;
+		compiled.vertices.assign(vertices.begin + mesh.first * vertex_size, vertices.begin + (mesh.first + mesh.count) * vertex_size);
+		if (indexed) {
+			for (GLsizei j = 0; j < mesh.index_count; ++j) {
+				compiled.indices.emplace_back(indices[mesh.index_first + j]);
+			}
+		} else {
+			//(unindexed blobs store every corner)
+			if (mesh.count > 0x10000) throw std::runtime_error(filename + ": mesh '" + name + "' is too large to index.");
+			for (GLsizei j = 0; j < mesh.count; ++j) {
+				compiled.indices.emplace_back(uint16_t(j));
+			}
+		}
+		for (uint32_t l = 0; l < mesh.lod_count; ++l) {
+			Compiled::Lod lod;
+			for (GLsizei j = 0; j < mesh.lods[l].index_count; ++j) {
+				lod.indices.emplace_back(indices[mesh.lods[l].index_first + j]);
+			}
+			lod.error = mesh.lods[l].error;
+			compiled.lods.emplace_back(lod);
+		}
+		if (existing.quantized) compiled.quantization = quantizations[i];
+		existing.names.emplace_back(name);
+	}
+
+	std::ifstream sources(filename + ".sources");
+	std::string line;
+	while (std::getline(sources, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos) continue;
+		existing.hashes[line.substr(tab + 1)] = std::strtoull(line.substr(0, tab).c_str(), nullptr, 16);
+	}
+}
+
+//------------ output ------------
+
+static void write_blob(std::string const &filename, bool quantize, std::vector< Source > const &sources, std::vector< Compiled > const &compiled) {
+	std::vector< uint8_t > data;
+	std::vector< char > strings;
+	std::vector< MeshIndex::Entry > index;
+	std::vector< uint16_t > indices;
+	std::vector< MeshIndex::IndexRange > ranges;
+	std::vector< MeshIndex::Quantization > quantization;
+	std::vector< MeshIndex::Lod > lods;
+
+	size_t const vertex_size = (quantize ? sizeof(MeshIndex::PackedVertex) : sizeof(MeshIndex::Vertex));
+	for (size_t i = 0; i < sources.size(); ++i) {
+		MeshIndex::Entry entry;
+		entry.name_begin = uint32_t(strings.size());
+		strings.insert(strings.end(), sources[i].name.begin(), sources[i].name.end());
+		entry.name_end = uint32_t(strings.size());
+		entry.vertex_begin = uint32_t(data.size() / vertex_size);
+		data.insert(data.end(), compiled[i].vertices.begin(), compiled[i].vertices.end());
+		entry.vertex_end = uint32_t(data.size() / vertex_size);
+		index.emplace_back(entry);
+
+		MeshIndex::IndexRange range;
+		range.index_begin = uint32_t(indices.size());
+		indices.insert(indices.end(), compiled[i].indices.begin(), compiled[i].indices.end());
+		range.index_end = uint32_t(indices.size());
+		ranges.emplace_back(range);
+
+		if (quantize) quantization.emplace_back(compiled[i].quantization);
+
+		//levels of detail go after the full mesh's indices:
+		for (auto const &l : compiled[i].lods) {
+			MeshIndex::Lod lod;
+			lod.entry = uint32_t(i);
+			lod.index_begin = uint32_t(indices.size());
+			indices.insert(indices.end(), l.indices.begin(), l.indices.end());
+			lod.index_end = uint32_t(indices.size());
+			lod.error = l.error;
+			lods.emplace_back(lod);
+		}
+	}
+
+	//write to a temporary file, so a failed run never leaves a partial blob behind:
+	std::string temp = filename + ".tmp";
+	{
+		std::ofstream blob(temp, std::ios::binary);
+		if (!blob) {
+			throw std::runtime_error("Failed to open '" + temp + "' for writing.");
+		}
+		//a table of contents goes first, so readers can find chunks (and meshes) without walking the file:
+		std::vector< std::pair< std::string, size_t > > toc;
+		toc.emplace_back(quantize ? "dat1" : "vtx0", data.size());
+		toc.emplace_back("str0", strings.size());
+		toc.emplace_back("idx0", index.size() * sizeof(MeshIndex::Entry));
+		toc.emplace_back("ix16", indices.size() * sizeof(uint16_t));
+		toc.emplace_back("ixr0", ranges.size() * sizeof(MeshIndex::IndexRange));
+		if (quantize) toc.emplace_back("qnt0", quantization.size() * sizeof(MeshIndex::Quantization));
+		if (!lods.empty()) toc.emplace_back("lod0", lods.size() * sizeof(MeshIndex::Lod));
+		write_toc(toc, &blob);
+
+		write_chunk(quantize ? "dat1" : "vtx0", data, &blob);
+		write_chunk("str0", strings, &blob);
+		write_chunk("idx0", index, &blob);
+		write_chunk("ix16", indices, &blob);
+		write_chunk("ixr0", ranges, &blob);
+		if (quantize) write_chunk("qnt0", quantization, &blob);
+		if (!lods.empty()) write_chunk("lod0", lods, &blob);
+		if (!blob) {
+			throw std::runtime_error("Failed to write '" + temp + "'.");
+		}
+	}
+#ifdef _WIN32
+	std::remove(filename.c_str()); //(rename won't replace files on windows)
+#endif
+	if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+		throw std::runtime_error("Failed to rename '" + temp + "' to '" + filename + "'.");
+	}
+
+	//record source hashes for --incremental:
+	if (std::all_of(sources.begin(), sources.end(), [](Source const &s) { return s.keep; })) return;
+	std::ofstream hashes(filename + ".sources");
+	hashes << "#source hashes for meshc --incremental (see meshc.cpp)\n";
+	for (size_t i = 0; i < sources.size(); ++i) {
+		if (sources[i].keep) continue;
+		char hex[17];
+		std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)compiled[i].hash);
+		hashes << hex << '\t' << sources[i].name << '\n';
+	}
+}
+
+int main(int argc, char **argv) {
+	uint32_t jobs = 0;
+	bool incremental = false;
+	bool quantize = true;
+	bool optimize_meshes = true;
+	bool lods = true;
+	bool optimize_only = false; //(optimize an existing blob rather than compiling a manifest)
+	std::vector< std::string > files;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--jobs" && argi + 1 < argc) {
+			jobs = uint32_t(std::strtoul(argv[++argi], nullptr, 10));
+		} else if (arg == "--incremental") {
+			incremental = true;
+		} else if (arg == "--float") {
+			quantize = false;
+		} else if (arg == "--no-optimize") {
+			optimize_meshes = false;
+		} else if (arg == "--no-lods") {
+			lods = false;
+		} else if (arg == "--optimize") {
+			optimize_only = true;
+		} else if (!arg.empty() && arg[0] == '-') {
+			files.clear();
+			break;
+		} else {
+			files.emplace_back(arg);
+		}
+	}
+	if (files.size() != 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--jobs N] [--incremental] [--float] [--no-optimize] [--no-lods] <meshes.list> <out.blob>\n"
+			"\t" << argv[0] << " --optimize [--jobs N] [--no-lods] <in.blob> <out.blob>\n"
+			"Compiles the .dae files listed in meshes.list into a mesh blob, or optimizes the meshes in an existing blob (see meshc.cpp)." << std::endl;
+		return 1;
+	}
+	std::string input = files[0]; //manifest (or blob, with --optimize)
+	std::string output = files[1];
+	if (optimize_only && (incremental || !optimize_meshes)) {
+		std::cerr << "--optimize can't be combined with --incremental or --no-optimize." << std::endl;
+		return 1;
+	}
+
+	try {
+		auto before = std::chrono::high_resolution_clock::now();
+
+		std::vector< Source > sources;
+		Existing existing;
+		if (optimize_only) {
+			//every mesh of the input is kept (in its order and format):
+			load_existing(input, &existing);
+			if (existing.names.empty() && !std::ifstream(input)) {
+				throw std::runtime_error("Failed to open '" + input + "'.");
+			}
+			quantize = existing.quantized;
+			for (auto const &name : existing.names) {
+				Source source;
+				source.name = name;
+				source.keep = true;
+				sources.emplace_back(source);
+			}
+		} else {
+			sources = load_manifest(input);
+			bool needs_existing = incremental || std::any_of(sources.begin(), sources.end(), [](Source const &s) { return s.keep; });
+			if (needs_existing) load_existing(output, &existing);
+		}
+		std::string const existing_name = (optimize_only ? input : output);
+
+		//workers take sources one at a time:
+		std::vector< Compiled > compiled(sources.size());
+		std::atomic< size_t > next(0);
+		auto work = [&]() {
+			for (size_t i = next++; i < sources.size(); i = next++) {
+				Source const &source = sources[i];
+				Compiled &out = compiled[i];
+				try {
+					if (source.keep) {
+						//kept meshes come straight from the existing output:
+						auto f = existing.meshes.find(source.name);
+						if (f == existing.meshes.end()) {
+							throw std::runtime_error("marked 'keep', but isn't in '" + existing_name + "'.");
+						}
+						if (existing.quantized == quantize) {
+							out = f->second;
+						} else {
+							//(converting between vertex formats)
+							encode(decode(f->second, existing.quantized), quantize, "'" + source.name + "'", &out);
+						}
+						out.how = Compiled::Kept;
+						if (optimize_meshes) optimize(&out, quantize);
+						out.lods.clear();
+						if (lods) make_lods(&out, quantize);
+						continue;
+					}
+
+					std::ifstream file(source.file, std::ios::binary);
+					std::ostringstream text;
+					text << file.rdbuf();
+					if (!file) throw std::runtime_error("Failed to read '" + source.file + "'.");
+					std::string const &contents = text.str();
+
+					//the hash covers everything the compiled mesh depends on:
+					out.hash = 0xcbf29ce484222325ULL;
+					out.hash = hash_bytes(out.hash, quantize ? "dat1" : "vtx0", 4);
+					out.hash = hash_bytes(out.hash, optimize_meshes ? "opt" : "raw", 3);
+					out.hash = hash_bytes(out.hash, lods ? "lod" : "one", 3);
+					out.hash = hash_bytes(out.hash, source.spec.data(), source.spec.size());
+					out.hash = hash_bytes(out.hash, contents.data(), contents.size());
+
+					if (incremental && existing.quantized == quantize) {
+						auto h = existing.hashes.find(source.name);
+						auto m = existing.meshes.find(source.name);
+						if (h != existing.hashes.end() && h->second == out.hash && m != existing.meshes.end()) {
+							uint64_t hash = out.hash;
+							out = m->second;
+							out.hash = hash;
+							out.how = Compiled::Reused;
+							continue;
+						}
+					}
+
+					compile(source, contents, quantize, &out);
+					out.how = Compiled::Built;
+					if (optimize_meshes) optimize(&out, quantize);
+					if (lods) make_lods(&out, quantize);
+				} catch (std::exception &e) {
+					out.error = e.what();
+				}
+			}
+		};
+		if (jobs == 0) jobs = std::max(1U, std::thread::hardware_concurrency());
+		jobs = std::max(1U, std::min(jobs, uint32_t(sources.size())));
+		std::vector< std::thread > workers;
+		for (uint32_t w = 0; w + 1 < jobs; ++w) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (auto &worker : workers) {
+			worker.join();
+		}
+
+		//report:
+		uint32_t built = 0, reused = 0, errors = 0;
+		for (size_t i = 0; i < sources.size(); ++i) {
+			Compiled const &c = compiled[i];
+			if (!c.error.empty()) {
+				std::cerr << "ERROR: " << sources[i].name << ": " << c.error << std::endl;
+				++errors;
+				continue;
+			}
+			size_t vertex_size = (quantize ? sizeof(MeshIndex::PackedVertex) : sizeof(MeshIndex::Vertex));
+			std::cout << "  " << sources[i].name << ": "
+				<< (c.how == Compiled::Built ? "compiled" : (c.how == Compiled::Reused ? "unchanged" : "kept"))
+				<< " (" << c.vertices.size() / vertex_size << " vertices, " << c.indices.size() / 3 << " triangles)";
+			if (c.optimized) {
+				//cache miss ratios, before -> after:
+				char stats[128];
+				std::snprintf(stats, sizeof(stats), " ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+					c.before.acmr(), c.after.acmr(), c.before.atvr(), c.after.atvr());
+				std::cout << stats;
+			}
+			if (!c.lods.empty()) {
+				std::cout << ", LODs";
+				for (auto const &lod : c.lods) {
+					char level[64];
+					std::snprintf(level, sizeof(level), " %u (%.3g)", uint32_t(lod.indices.size() / 3), lod.error);
+					std::cout << level;
+				}
+				std::cout << " triangles (error)";
+			}
+			std::cout << std::endl;
+			if (c.how == Compiled::Built) ++built;
+			else ++reused;
+		}
+		if (errors) {
+			std::cerr << errors << " mesh(es) failed to compile; '" << output << "' was not changed." << std::endl;
+			return 1;
+		}
+
+		//with nothing compiled and the same meshes in the same order, the output is already up to date:
+		std::vector< std::string > names;
+		for (auto const &source : sources) names.emplace_back(source.name);
+		if (incremental && built == 0 && names == existing.names) {
+			std::cout << "'" << output << "' is up to date." << std::endl;
+			return 0;
+		}
+
+		write_blob(output, quantize, sources, compiled);
+
+		auto after = std::chrono::high_resolution_clock::now();
+		std::cout << "Wrote " << sources.size() << " meshes (" << built << " compiled, " << reused << " unchanged or kept) to '" << output << "' in "
+			<< std::chrono::duration< double, std::milli >(after - before).count() << "ms using " << jobs << " job(s)." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
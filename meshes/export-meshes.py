@@ -28,22 +28,64 @@ bpy.ops.wm.open_mainfile(filepath=infile)
 
 do_texcoord = False
 
+#write compact 12-byte vertices (int16 positions + octahedral int8 normals + colors) to a 'dat1' chunk
+# instead of 28-byte float vertices to a 'vtx0' chunk:
+do_quantize = True
+assert(not (do_quantize and do_texcoord)) #quantized vertices have no room for texcoords
+
+#octahedral normal encoding, as two values in [-127,127]:
+def oct_encode(n):
+    l1 = abs(n[0]) + abs(n[1]) + abs(n[2])
+    if l1 == 0.0:
+        return (0, 0)
+    x = n[0] / l1
+    y = n[1] / l1
+    if n[2] < 0.0:
+        (x, y) = ((1.0 - abs(y)) * (1.0 if x >= 0.0 else -1.0), (1.0 - abs(x)) * (1.0 if y >= 0.0 else -1.0))
+    return (int(round(max(-1.0, min(1.0, x)) * 127)), int(round(max(-1.0, min(1.0, y)) * 127)))
+
+#quantize a list of 28-byte vertices of one mesh; returns 12-byte vertices and the mesh's 'qnt0' entry:
+def quantize_mesh(verts):
+    positions = [struct.unpack_from('fff', v, 0) for v in verts]
+    lo = [min(p[c] for p in positions) for c in range(0,3)]
+    hi = [max(p[c] for p in positions) for c in range(0,3)]
+    offset = [0.5 * (lo[c] + hi[c]) for c in range(0,3)]
+    scale = [0.5 * (hi[c] - lo[c]) / 32767.0 for c in range(0,3)]
+    packed = []
+    for v in verts:
+        p = struct.unpack_from('fff', v, 0)
+        n = struct.unpack_from('fff', v, 12)
+        q = [int(round((p[c] - offset[c]) / scale[c])) if scale[c] > 0.0 else 0 for c in range(0,3)]
+        q = [max(-32767, min(32767, x)) for x in q]
+        packed.append(struct.pack('hhh', *q) + struct.pack('bb', *oct_encode(n)) + v[24:28])
+    return (packed, struct.pack('ffffff', *(scale + offset)))
+
 #names of objects whose meshes to write (not actually the names of the meshes):
 to_write = []
 for obj in bpy.data.objects:
     if obj.type == 'MESH':
         to_write.append(obj.name)
 
-#data contains vertex and normal data from the meshes:
+#data contains vertex and normal data from the meshes (each distinct vertex once per mesh):
 data = b''
 
 #strings contains the mesh names:
 strings = b''
 
+#quantization gives position scale and offset for each mesh (parallel to index; only if do_quantize):
+quantization = b''
+
 #index gives offsets into the data (and names) for each mesh:
 index = b''
 
+#indices contains 16-bit triangle indices, relative to the first vertex of their mesh:
+indices = b''
+
+#ranges gives offsets into the indices for each mesh (parallel to index):
+ranges = b''
+
 vertex_count = 0
+index_count = 0
 for name in to_write:
     print("Writing '" + name + "'...")
     bpy.ops.object.mode_set(mode='OBJECT') #get out of edit mode (just in case)
@@ -69,16 +111,6 @@ for name in to_write:
     mesh = obj.data
     mesh.calc_normals_split()
 
-    #record mesh name, start position and vertex count in the index:
-    name_begin = len(strings)
-    strings += bytes(name, "utf8")
-    name_end = len(strings)
-    index += struct.pack('I', name_begin)
-    index += struct.pack('I', name_end)
-
-    index += struct.pack('I', vertex_count)
-    index += struct.pack('I', vertex_count + len(mesh.polygons) * 3)
-
     uvs = None
     if do_texcoord:
         if len(obj.data.uv_layers) == 0:
@@ -86,37 +118,76 @@ for name in to_write:
         else:
             uvs = obj.data.uv_layers.active.data
 
-    #write the mesh:
+    #gather the mesh's triangle corners:
+    corners = []
     for poly in mesh.polygons:
         assert(len(poly.loop_indices) == 3)
         for i in range(0,3):
             assert(mesh.loops[poly.loop_indices[i]].vertex_index == poly.vertices[i])
             loop = mesh.loops[poly.loop_indices[i]]
             vertex = mesh.vertices[loop.vertex_index]
+            vert = b''
             for x in mesh.vertices[loop.vertex_index].co:
-                data += struct.pack('f', x)
+                vert += struct.pack('f', x)
             for x in loop.normal:
-                data += struct.pack('f', x)
+                vert += struct.pack('f', x)
             #TODO: set 'col' based on object's active vertex colors array.
             # you should be able to use code much like the texcoord code below.
             col = mesh.vertex_colors.active.data[poly.loop_indices[i]].color
-            data += struct.pack('BBBB', int(col.r * 255), int(col.g * 255), int(col.b * 255), 255)
+            vert += struct.pack('BBBB', int(col.r * 255), int(col.g * 255), int(col.b * 255), 255)
 
             if do_texcoord:
                 if uvs != None:
                     uv = uvs[poly.loop_indices[i]].uv
-                    data += struct.pack('ff', uv.x, uv.y)
+                    vert += struct.pack('ff', uv.x, uv.y)
                 else:
-                    data += struct.pack('ff', 0, 0)
-    vertex_count += len(mesh.polygons) * 3
+                    vert += struct.pack('ff', 0, 0)
+
+            corners.append(vert)
+
+    if do_quantize:
+        (corners, q) = quantize_mesh(corners)
+        quantization += q
+
+    #write the mesh, sharing identical vertices between triangles:
+    mesh_data = []
+    mesh_lookup = dict()
+    for vert in corners:
+        if vert not in mesh_lookup:
+            mesh_lookup[vert] = len(mesh_data)
+            mesh_data.append(vert)
+        indices += struct.pack('H', mesh_lookup[vert])
+
+    assert(len(mesh_data) <= 0x10000) #indices are 16-bit
+
+    #record mesh name, vertex range and index range in the index:
+    name_begin = len(strings)
+    strings += bytes(name, "utf8")
+    name_end = len(strings)
+    index += struct.pack('I', name_begin)
+    index += struct.pack('I', name_end)
+
+    index += struct.pack('I', vertex_count)
+    index += struct.pack('I', vertex_count + len(mesh_data))
+    ranges += struct.pack('I', index_count)
+    ranges += struct.pack('I', index_count + len(mesh.polygons) * 3)
+
+    data += b''.join(mesh_data)
+    vertex_count += len(mesh_data)
+    index_count += len(mesh.polygons) * 3
 
 #check that we wrote as much data as anticipated:
-assert(vertex_count * (4*3+4*3+4*1) == len(data))
+if do_quantize:
+    assert(vertex_count * (2*3+1*2+1*4) == len(data))
+    assert(len(quantization) == len(index) // 16 * 24)
+else:
+    assert(vertex_count * (4*3+4*3+4*1) == len(data))
+assert(index_count * 2 == len(indices))
 
 #write the data chunk and index chunk to an output blob:
 blob = open(outfile, 'wb')
-#first chunk: the data
-blob.write(struct.pack('4s',b'dat0')) #type
+#first chunk: the (deduplicated) data
+blob.write(struct.pack('4s',b'dat1' if do_quantize else b'vtx0')) #type
 blob.write(struct.pack('I', len(data))) #length
 blob.write(data)
 #second chunk: the strings
@@ -127,7 +198,20 @@ blob.write(strings)
 blob.write(struct.pack('4s',b'idx0')) #type
 blob.write(struct.pack('I', len(index))) #length
 blob.write(index)
-
-print("Wrote " + str(blob.tell()) + " bytes [== " + str(len(data)+8) + " bytes of data + " + str(len(strings)+8) + " bytes of strings + " + str(len(index)+8) + " bytes of index] to '" + outfile + "'")
+#fourth chunk: the triangle indices
+blob.write(struct.pack('4s',b'ix16')) #type
+blob.write(struct.pack('I', len(indices))) #length
+blob.write(indices)
+#fifth chunk: the index ranges
+blob.write(struct.pack('4s',b'ixr0')) #type
+blob.write(struct.pack('I', len(ranges))) #length
+blob.write(ranges)
+if do_quantize:
+    #sixth chunk: the quantization parameters
+    blob.write(struct.pack('4s',b'qnt0')) #type
+    blob.write(struct.pack('I', len(quantization))) #length
+    blob.write(quantization)
+
+print("Wrote " + str(blob.tell()) + " bytes [== " + str(len(data)+8) + " bytes of data + " + str(len(strings)+8) + " bytes of strings + " + str(len(index)+8) + " bytes of index + " + str(len(indices)+8) + " bytes of triangle indices + " + str(len(ranges)+8) + " bytes of index ranges + " + str(len(quantization)+8 if do_quantize else 0) + " bytes of quantization] to '" + outfile + "'")
 
 blob.close()
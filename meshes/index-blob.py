@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+
+#Converts a blob written by older versions of export-meshes.py to an indexed (and, optionally, quantized) blob.
+#Usage:
+#python3 index-blob.py [--quantize] <in.blob> <out.blob>
+
+import sys
+import struct
+
+args = sys.argv[1:]
+do_quantize = False
+if len(args) > 0 and args[0] == '--quantize':
+    do_quantize = True
+    args = args[1:]
+
+if len(args) != 2:
+    print("\n\nUsage:\npython3 index-blob.py [--quantize] <in.blob> <out.blob>\nShares identical vertices within each mesh of a dat0/str0/idx0 (or vtx0/str0/idx0/ix16/ixr0) blob and writes a vtx0/str0/idx0/ix16/ixr0 blob.\nWith --quantize, writes 12-byte vertices to a dat1 chunk and adds a qnt0 chunk.\n")
+    exit(1)
+
+infile = args[0]
+outfile = args[1]
+
+VERTEX_SIZE = 4*3+4*3+4*1
+
+blob = open(infile, 'rb').read()
+
+def read_chunk(at, magic):
+    (got, length) = struct.unpack_from('4sI', blob, at)
+    if got != magic:
+        raise RuntimeError("Expected '" + magic.decode() + "' chunk, got '" + got.decode() + "'.")
+    return (blob[at+8:at+8+length], at+8+length)
+
+#octahedral normal encoding, as two values in [-127,127] (same as export-meshes.py):
+def oct_encode(n):
+    l1 = abs(n[0]) + abs(n[1]) + abs(n[2])
+    if l1 == 0.0:
+        return (0, 0)
+    x = n[0] / l1
+    y = n[1] / l1
+    if n[2] < 0.0:
+        (x, y) = ((1.0 - abs(y)) * (1.0 if x >= 0.0 else -1.0), (1.0 - abs(x)) * (1.0 if y >= 0.0 else -1.0))
+    return (int(round(max(-1.0, min(1.0, x)) * 127)), int(round(max(-1.0, min(1.0, y)) * 127)))
+
+#quantize a list of 28-byte vertices of one mesh; returns 12-byte vertices and the mesh's 'qnt0' entry (same as export-meshes.py):
+def quantize_mesh(verts):
+    positions = [struct.unpack_from('fff', v, 0) for v in verts]
+    lo = [min(p[c] for p in positions) for c in range(0,3)]
+    hi = [max(p[c] for p in positions) for c in range(0,3)]
+    offset = [0.5 * (lo[c] + hi[c]) for c in range(0,3)]
+    scale = [0.5 * (hi[c] - lo[c]) / 32767.0 for c in range(0,3)]
+    packed = []
+    for v in verts:
+        p = struct.unpack_from('fff', v, 0)
+        n = struct.unpack_from('fff', v, 12)
+        q = [int(round((p[c] - offset[c]) / scale[c])) if scale[c] > 0.0 else 0 for c in range(0,3)]
+        q = [max(-32767, min(32767, x)) for x in q]
+        packed.append(struct.pack('hhh', *q) + struct.pack('bb', *oct_encode(n)) + v[24:28])
+    return (packed, struct.pack('ffffff', *(scale + offset)))
+
+#read each mesh as a list of triangle corners (28-byte float vertices):
+meshes = []
+(magic,) = struct.unpack_from('4s', blob, 0)
+if magic == b'dat0':
+    (soup, at) = read_chunk(0, b'dat0')
+    (strings, at) = read_chunk(at, b'str0')
+    (old_index, at) = read_chunk(at, b'idx0')
+    assert(len(soup) % VERTEX_SIZE == 0)
+    for (name_begin, name_end, vertex_begin, vertex_end) in struct.iter_unpack('IIII', old_index):
+        corners = [soup[v*VERTEX_SIZE:(v+1)*VERTEX_SIZE] for v in range(vertex_begin, vertex_end)]
+        meshes.append((name_begin, name_end, corners))
+elif magic == b'vtx0':
+    (verts, at) = read_chunk(0, b'vtx0')
+    (strings, at) = read_chunk(at, b'str0')
+    (old_index, at) = read_chunk(at, b'idx0')
+    (old_indices, at) = read_chunk(at, b'ix16')
+    (old_ranges, at) = read_chunk(at, b'ixr0')
+    old_indices = struct.unpack(str(len(old_indices) // 2) + 'H', old_indices)
+    for ((name_begin, name_end, vertex_begin, vertex_end), (index_begin, index_end)) in zip(struct.iter_unpack('IIII', old_index), struct.iter_unpack('II', old_ranges)):
+        corners = [verts[(vertex_begin+i)*VERTEX_SIZE:(vertex_begin+i+1)*VERTEX_SIZE] for i in old_indices[index_begin:index_end]]
+        meshes.append((name_begin, name_end, corners))
+else:
+    raise RuntimeError("Don't know how to convert a blob starting with a '" + magic.decode() + "' chunk.")
+assert(at == len(blob))
+
+data = b''
+index = b''
+indices = b''
+ranges = b''
+quantization = b''
+
+vertex_count = 0
+index_count = 0
+for (name_begin, name_end, corners) in meshes:
+    if do_quantize:
+        (corners, q) = quantize_mesh(corners)
+        quantization += q
+
+    mesh_data = []
+    mesh_lookup = dict()
+    for vert in corners:
+        if vert not in mesh_lookup:
+            mesh_lookup[vert] = len(mesh_data)
+            mesh_data.append(vert)
+        indices += struct.pack('H', mesh_lookup[vert])
+
+    assert(len(mesh_data) <= 0x10000) #indices are 16-bit
+
+    index += struct.pack('IIII', name_begin, name_end, vertex_count, vertex_count + len(mesh_data))
+    ranges += struct.pack('II', index_count, index_count + len(corners))
+
+    print("'" + strings[name_begin:name_end].decode() + "': " + str(len(corners)) + " -> " + str(len(mesh_data)) + " vertices")
+
+    data += b''.join(mesh_data)
+    vertex_count += len(mesh_data)
+    index_count += len(corners)
+
+chunks = [(b'dat1' if do_quantize else b'vtx0', data), (b'str0', strings), (b'idx0', index), (b'ix16', indices), (b'ixr0', ranges)]
+if do_quantize:
+    chunks.append((b'qnt0', quantization))
+
+out = open(outfile, 'wb')
+for (magic, chunk) in chunks:
+    out.write(struct.pack('4s', magic)) #type
+    out.write(struct.pack('I', len(chunk))) #length
+    out.write(chunk)
+
+print("Wrote " + str(out.tell()) + " bytes (was " + str(len(blob)) + ") to '" + outfile + "'")
+
+out.close()
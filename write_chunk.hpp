@@ -0,0 +1,69 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+//write_chunk writes the chunks that read_chunk reads:
+// (4-byte magic, uint32 size, size bytes of data)
+
+template< typename T >
+void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *_to) {
+	assert(_to);
+	auto &to = *_to;
+
+	if (magic.size() != 4) {
+		throw std::runtime_error("Chunk magic must be four characters");
+	}
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	ChunkHeader header;
+	header.magic[0] = magic[0];
+	header.magic[1] = magic[1];
+	header.magic[2] = magic[2];
+	header.magic[3] = magic[3];
+	header.size = uint32_t(from.size() * sizeof(T));
+
+	to.write(reinterpret_cast< char const * >(&header), sizeof(header));
+	to.write(reinterpret_cast< char const * >(from.data()), from.size() * sizeof(T));
+}
+
+//write_toc writes the table of contents that MappedBlob reads (a "toc1" chunk) for chunks that will be
+// written by write_chunk right after it, given each one's magic and data size in bytes:
+inline void write_toc(std::vector< std::pair< std::string, size_t > > const &chunks, std::ostream *_to) {
+	assert(_to);
+
+	struct TocEntry { //(see MappedBlob::TocEntry)
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t offset = 0;
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(TocEntry) == 12, "entry is packed");
+
+	std::vector< TocEntry > toc(chunks.size());
+	size_t offset = 8 + toc.size() * sizeof(TocEntry); //(past the table's header and data)
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		if (chunks[i].first.size() != 4) {
+			throw std::runtime_error("Chunk magic must be four characters");
+		}
+		offset += 8; //(the chunk's header)
+		if (offset + chunks[i].second > 0xffffffff) {
+			throw std::runtime_error("Chunks are too large for a table of contents");
+		}
+		std::memcpy(toc[i].magic, chunks[i].first.data(), 4);
+		toc[i].offset = uint32_t(offset);
+		toc[i].size = uint32_t(chunks[i].second);
+		offset += chunks[i].second;
+	}
+	write_chunk("toc1", toc, _to);
+}